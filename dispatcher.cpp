@@ -1,18 +1,54 @@
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
 #include <sqlite3.h>
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
 #include <chrono>
+#include <climits>
 #include <cmath>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
-#include <optional>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <sstream>
 #include <random>
 #include <string>
 #include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 using Clock = std::chrono::steady_clock;
 using Ms = std::chrono::milliseconds;
@@ -23,6 +59,51 @@ struct Args {
     int max_retries = 2;
     int mean_ms = 300;
     int stddev_ms = 100;
+    int workers = 1;
+    int db_batch = 1000;
+    bool virtual_clock = false;
+    int ingest_window = 4096;       // max queued jobs before ingestion pauses
+    std::string input;              // JSONL trace; "-" = stdin; empty = synthetic
+    double arrival_rate = 0;        // jobs/s; 0 = closed batch seeded up front
+    std::string arrival_dist = "poisson"; // poisson | constant | bursty
+    int burst_on_ms = 1000;
+    int burst_off_ms = 1000;
+    int keep_failures = 0;          // retain the last N terminal failures
+    std::string log_level = "job";  // quiet | summary | job
+    int log_rate = 0;               // max job lines per second; 0 = unlimited
+    std::string policy = "strict";  // strict | wfq | edf | mlfq
+    int deadline_ms = 1000;         // default relative deadline unit for edf
+    int mlfq_boost_ms = 1000;       // max wait in a lower mlfq level
+    bool journal = false;           // persist queued jobs to the queue table
+    int resume = 0;                 // run_id whose journaled queue to resume
+    uint64_t seed = 0;              // RNG seed; 0 = pick one at startup
+    std::string trace;              // Chrome trace-event JSON output path
+    int metrics_port = 0;           // serve Prometheus text on this port; 0 = off
+    std::string executor = "sim";   // sim | task:<name> | shell
+    std::string command;            // --executor shell command template
+    int max_inflight = 0;           // >0: event-loop workers with this many attempts in flight
+    int coordinator_port = 0;       // >0: lease jobs to --connect workers on this port
+    std::string connect;            // host:port of a coordinator; run as a remote worker
+    int lease_batch = 32;           // jobs per lease
+    int lease_timeout_ms = 5000;    // silence after which a worker's lease is re-enqueued
+    int batch = 1;                  // jobs a worker pops and completes per scheduler call
+    std::string sweep;              // sweep.json parameter grid; run every scenario
+    int sweep_threads = 0;          // scenarios run in parallel; 0 = one per core
+    bool job_rows = true;           // false: runs row only (sweep scenarios)
+    std::string sink = "sqlite";    // job rows: sqlite | csv[:path] | columnar[:path]
+    int max_queue = 0;              // queued-job bound for admission; 0 = unbounded
+    std::string overload = "block"; // full queue: block | reject | shed
+    std::string jitter = "none";    // retry backoff jitter: none | full | decorrelated
+    int backoff_base_ms = 100;      // first retry's backoff; doubles per attempt
+    int backoff_cap_ms = 60000;     // 0 = uncapped
+    double retry_budget = 0;        // max retry share of attempts in the window; 0 = off
+    double breaker_threshold = 0;   // failure rate that opens the breaker; 0 = off
+    int breaker_window_ms = 10000;  // rolling window for budget and breaker
+    int breaker_open_ms = 5000;     // how long an open breaker denies retries
+    std::string fail_probs;         // per-attempt failure chances; empty = 0.2,0.14,0.08,0.02
+    std::string fail_spike;         // FROM_MS:TO_MS:P, failure chance override
+    std::string dedup = "off";      // resubmitted ext_id: merge | reject | off
+    std::string pin_workers = "off"; // worker CPU affinity: off | compact | spread
     std::string db = "dispatcher.db";
 };
 
@@ -32,11 +113,57 @@ Args parse_args(int argc, char** argv) {
         std::string k = argv[i];
         auto need = [&](int &out){ if (i+1 < argc){ out = std::stoi(argv[++i]); } };
         auto needStr = [&](std::string &out){ if (i+1 < argc){ out = argv[++i]; } };
+        auto needDbl = [&](double &out){ if (i+1 < argc){ out = std::stod(argv[++i]); } };
+        auto needU64 = [&](uint64_t &out){ if (i+1 < argc){ out = std::stoull(argv[++i]); } };
         if (k == "--jobs") need(a.jobs);
         else if (k == "--max-retries") need(a.max_retries);
         else if (k == "--mean-ms") need(a.mean_ms);
         else if (k == "--stddev-ms") need(a.stddev_ms);
+        else if (k == "--workers") need(a.workers);
+        else if (k == "--db-batch") need(a.db_batch);
         else if (k == "--db") needStr(a.db);
+        else if (k == "--virtual-clock") a.virtual_clock = true;
+        else if (k == "--input") needStr(a.input);
+        else if (k == "--ingest-window") need(a.ingest_window);
+        else if (k == "--arrival-rate") needDbl(a.arrival_rate);
+        else if (k == "--arrival-dist") needStr(a.arrival_dist);
+        else if (k == "--burst-on-ms") need(a.burst_on_ms);
+        else if (k == "--burst-off-ms") need(a.burst_off_ms);
+        else if (k == "--keep-failures") need(a.keep_failures);
+        else if (k == "--log-level") needStr(a.log_level);
+        else if (k == "--log-rate") need(a.log_rate);
+        else if (k == "--policy") needStr(a.policy);
+        else if (k == "--deadline-ms") need(a.deadline_ms);
+        else if (k == "--mlfq-boost-ms") need(a.mlfq_boost_ms);
+        else if (k == "--journal") a.journal = true;
+        else if (k == "--resume") need(a.resume);
+        else if (k == "--seed") needU64(a.seed);
+        else if (k == "--trace") needStr(a.trace);
+        else if (k == "--metrics-port") need(a.metrics_port);
+        else if (k == "--executor") needStr(a.executor);
+        else if (k == "--command") needStr(a.command);
+        else if (k == "--max-inflight") need(a.max_inflight);
+        else if (k == "--coordinator") need(a.coordinator_port);
+        else if (k == "--connect") needStr(a.connect);
+        else if (k == "--lease-batch") need(a.lease_batch);
+        else if (k == "--lease-timeout-ms") need(a.lease_timeout_ms);
+        else if (k == "--batch") need(a.batch);
+        else if (k == "--sweep") needStr(a.sweep);
+        else if (k == "--sweep-threads") need(a.sweep_threads);
+        else if (k == "--sink") needStr(a.sink);
+        else if (k == "--max-queue") need(a.max_queue);
+        else if (k == "--overload") needStr(a.overload);
+        else if (k == "--jitter") needStr(a.jitter);
+        else if (k == "--backoff-base-ms") need(a.backoff_base_ms);
+        else if (k == "--backoff-cap-ms") need(a.backoff_cap_ms);
+        else if (k == "--retry-budget") needDbl(a.retry_budget);
+        else if (k == "--breaker-threshold") needDbl(a.breaker_threshold);
+        else if (k == "--breaker-window-ms") need(a.breaker_window_ms);
+        else if (k == "--breaker-open-ms") need(a.breaker_open_ms);
+        else if (k == "--fail-probs") needStr(a.fail_probs);
+        else if (k == "--fail-spike") needStr(a.fail_spike);
+        else if (k == "--dedup") needStr(a.dedup);
+        else if (k == "--pin-workers") needStr(a.pin_workers);
     }
     return a;
 }
@@ -45,42 +172,444 @@ int64_t now_ms() {
     return std::chrono::duration_cast<Ms>(Clock::now().time_since_epoch()).count();
 }
 
+// Time source for one dispatcher run. Real mode reads steady_clock; virtual
+// mode only moves when the discrete-event loop advances `vnow`, which it does
+// from a single thread.
+struct SimClock {
+    bool is_virtual = false;
+    int64_t vnow = 0;
+
+    int64_t now() const { return is_virtual ? vnow : now_ms(); }
+};
+
+inline uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256**: 32 bytes of state and a few cycles per draw, against
+// mt19937_64's 2.5KB. Satisfies UniformRandomBitGenerator so the <random>
+// distributions can sit on top of it.
+struct Xoshiro256 {
+    using result_type = uint64_t;
+    uint64_t s[4];
+
+    explicit Xoshiro256(uint64_t seed = 0) { reseed(seed); }
+    void reseed(uint64_t seed) {
+        for (auto& w : s) w = splitmix64(seed);
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    result_type operator()() {
+        uint64_t r = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return r;
+    }
+};
+
+// One instance per thread. Draws for a job come from a stream keyed by
+// (seed, ext_id, stream) via begin(): stream n < 256 is attempt n, and
+// kPriorityStream picks the initial priority. A job's priority, service
+// times and outcomes therefore depend only on --seed, not on which worker
+// ran it or how threads interleaved.
 struct RNG {
-    std::mt19937_64 gen{std::random_device{}()};
+    static constexpr int kPriorityStream = 256;
+    static constexpr int kMaxFailSteps = 8;
+
+    uint64_t seed;
+    Xoshiro256 gen;
     std::normal_distribution<double> service_ms_norm;
     std::uniform_int_distribution<int> prio_dist{1, 10};
-    std::bernoulli_distribution failure_dist{0.20}; // 20% base failure chance
+    int fail_steps = 4;                     // last step repeats for later attempts
+    uint64_t fail_below[kMaxFailSteps];     // gen() < fail_below[a]: attempt a fails
+    // --fail-spike: attempts starting in [spike_from, spike_to) fail with
+    // this chance instead, whatever their attempt number.
+    int64_t spike_from = 0, spike_to = 0;
+    uint64_t spike_below = 0;
+
+    RNG(int mean_ms, int stddev_ms, uint64_t seed_)
+      : seed(seed_), gen(seed_), service_ms_norm(mean_ms, stddev_ms) {
+        for (int a = 0; a < fail_steps; ++a) {
+            // 20% base failure chance, slightly reduced with attempts to
+            // simulate fixes
+            fail_below[a] = threshold(std::max(0.02, 0.20 - 0.06 * a));
+        }
+    }
 
-    RNG(int mean_ms, int stddev_ms)
-      : service_ms_norm(mean_ms, stddev_ms) {}
+    static uint64_t threshold(double p) {
+        if (p <= 0) return 0;
+        if (p >= 1) return UINT64_MAX;
+        return (uint64_t)(p * 18446744073709551616.0);
+    }
+    // Per-attempt failure chances (--fail-probs), at most kMaxFailSteps.
+    void set_fail_probs(const std::vector<double>& p) {
+        if (p.empty()) return;
+        fail_steps = (int)std::min<size_t>(p.size(), kMaxFailSteps);
+        for (int a = 0; a < fail_steps; ++a) fail_below[a] = threshold(p[a]);
+    }
+    void set_spike(int64_t from, int64_t to, double p) {
+        spike_from = from;
+        spike_to = to;
+        spike_below = threshold(p);
+    }
+
+    void begin(int ext_id, int stream) {
+        uint64_t x = seed ^ ((uint64_t)(uint32_t)ext_id << 32 | (uint32_t)stream);
+        gen.reseed(splitmix64(x));
+        service_ms_norm.reset();
+    }
 
     int service_ms() {
         int v = (int)std::round(std::max(30.0, service_ms_norm(gen)));
         return v;
     }
     int priority() { return prio_dist(gen); }
-    bool should_fail(int attempt) {
-        // Slightly reduce failure chance with attempts to simulate fixes
-        double p = std::max(0.02, 0.20 - 0.06 * attempt);
-        std::bernoulli_distribution d(p);
-        return d(gen);
+    bool should_fail(int attempt, int64_t start_ts = INT64_MIN) {
+        if (start_ts >= spike_from && start_ts < spike_to) return gen() < spike_below;
+        return gen() < fail_below[std::min(attempt, fail_steps - 1)];
+    }
+};
+
+// --------------------------- Profiling ---------------------------
+// Where dispatch time goes, by phase. PROF_SCOPE(phase) charges the
+// enclosing block to the calling thread's counters; a nested scope's time is
+// taken out of its parent, so each phase reports self time and the phases
+// never double count. Timestamps are TSC ticks where available (converted
+// with a ratio measured against steady_clock) and steady_clock ns otherwise.
+// With --trace every scope also becomes a Chrome trace-event "X" record.
+// Building with -DDISPATCHER_NO_PROFILE compiles all of it away.
+enum class Phase : uint8_t { Schedule, Backoff, Service, Db, Log, kCount };
+constexpr int kPhases = (int)Phase::kCount;
+
+const char* phase_str(Phase p) {
+    switch (p) {
+        case Phase::Schedule: return "schedule";
+        case Phase::Backoff:  return "backoff";
+        case Phase::Service:  return "service";
+        case Phase::Db:       return "db";
+        case Phase::Log:      return "log";
+        case Phase::kCount:   break;
+    }
+    return "unknown";
+}
+
+inline uint64_t prof_ticks() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct PhaseTotals {
+    uint64_t ticks[kPhases] = {};
+    uint64_t calls[kPhases] = {};
+
+    void add(const PhaseTotals& o, int64_t sign = 1) {
+        for (int p = 0; p < kPhases; ++p) {
+            ticks[p] += (uint64_t)sign * o.ticks[p];
+            calls[p] += (uint64_t)sign * o.calls[p];
+        }
+    }
+};
+
+struct Profiler {
+    static constexpr size_t kMaxTraceEvents = 4 << 20;  // ~100MB of JSON
+
+    struct TraceEvent {
+        uint64_t start, dur;    // ticks
+        Phase phase;
+    };
+    // Owned by one thread; counters are atomics only so snapshot() may read
+    // them while the owner runs. The owner updates with plain load+store.
+    struct ThreadProf {
+        std::atomic<uint64_t> ticks[kPhases] = {};
+        std::atomic<uint64_t> calls[kPhases] = {};
+        uint64_t child = 0;     // ticks of finished scopes nested in the open one
+        int tid = 0;
+        std::string name;
+        std::mutex trace_mu;    // trace is drained by write_trace()
+        std::vector<TraceEvent> trace;
+
+        void charge(Phase p, uint64_t self) {
+            int i = (int)p;
+            ticks[i].store(ticks[i].load(std::memory_order_relaxed) + self,
+                           std::memory_order_relaxed);
+            calls[i].store(calls[i].load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+        }
+    };
+    struct ThreadSlot {
+        ThreadProf* tp;
+        explicit ThreadSlot(Profiler* p) : tp(p->attach()) {}
+        ~ThreadSlot() { profiler_detach(tp); }
+    };
+    struct RetiredTrace {
+        int tid;
+        std::string name;
+        std::vector<TraceEvent> events;
+    };
+
+    std::mutex mu;                      // guards live, retired, retired_traces
+    std::vector<ThreadProf*> live;
+    PhaseTotals retired;                // counters of threads that exited
+    std::vector<RetiredTrace> retired_traces;
+    int next_tid = 0;
+    std::atomic<bool> tracing{false};
+    std::atomic<size_t> trace_events{0};
+    uint64_t t0_ticks = prof_ticks();
+    Clock::time_point t0 = Clock::now();
+
+    ThreadProf& local() {
+        thread_local ThreadSlot slot(this);
+        return *slot.tp;
+    }
+
+    ThreadProf* attach() {
+        ThreadProf* tp = new ThreadProf();
+        std::lock_guard<std::mutex> lk(mu);
+        tp->tid = ++next_tid;
+        tp->name = "thread " + std::to_string(tp->tid);
+        live.push_back(tp);
+        return tp;
+    }
+
+    static void profiler_detach(ThreadProf* tp);
+
+    void detach(ThreadProf* tp) {
+        std::lock_guard<std::mutex> lk(mu);
+        for (int p = 0; p < kPhases; ++p) {
+            retired.ticks[p] += tp->ticks[p].load();
+            retired.calls[p] += tp->calls[p].load();
+        }
+        if (!tp->trace.empty())
+            retired_traces.push_back(RetiredTrace{tp->tid, tp->name, std::move(tp->trace)});
+        live.erase(std::find(live.begin(), live.end(), tp));
+        delete tp;
+    }
+
+    void name_thread(const std::string& name) {
+        ThreadProf& tp = local();
+        std::lock_guard<std::mutex> lk(mu);
+        tp.name = name;
+    }
+
+    PhaseTotals snapshot() {
+        std::lock_guard<std::mutex> lk(mu);
+        PhaseTotals t = retired;
+        for (ThreadProf* tp : live)
+            for (int p = 0; p < kPhases; ++p) {
+                t.ticks[p] += tp->ticks[p].load(std::memory_order_relaxed);
+                t.calls[p] += tp->calls[p].load(std::memory_order_relaxed);
+            }
+        return t;
+    }
+
+    double ns_per_tick() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        uint64_t dt = prof_ticks() - t0_ticks;
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - t0).count();
+        return dt > 0 ? ns / (double)dt : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+
+    // Drops events from earlier runs and starts recording new ones.
+    void start_trace() {
+        std::lock_guard<std::mutex> lk(mu);
+        retired_traces.clear();
+        for (ThreadProf* tp : live) {
+            std::lock_guard<std::mutex> tl(tp->trace_mu);
+            tp->trace.clear();
+        }
+        trace_events.store(0);
+        tracing.store(true);
+    }
+
+    void record(ThreadProf& tp, Phase p, uint64_t start, uint64_t dur) {
+        if (trace_events.fetch_add(1, std::memory_order_relaxed) >= kMaxTraceEvents) return;
+        std::lock_guard<std::mutex> lk(tp.trace_mu);
+        tp.trace.push_back(TraceEvent{start, dur, p});
+    }
+
+    // Writes everything recorded since start_trace() as a Chrome trace-event
+    // JSON file (chrome://tracing, ui.perfetto.dev) and stops tracing.
+    bool write_trace(const std::string& path) {
+        tracing.store(false);
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        double us_per_tick = ns_per_tick() / 1000.0;
+        bool first = true;
+        auto sep = [&]{ std::fputs(first ? "\n" : ",\n", f); first = false; };
+        auto dump = [&](int tid, const std::string& name, const std::vector<TraceEvent>& evs){
+            sep();
+            std::fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                            "\"args\":{\"name\":\"%s\"}}", tid, name.c_str());
+            for (const TraceEvent& e : evs) {
+                sep();
+                std::fprintf(f, "{\"name\":\"%s\",\"cat\":\"dispatch\",\"ph\":\"X\",\"pid\":1,"
+                                "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                             phase_str(e.phase), tid,
+                             (double)(int64_t)(e.start - t0_ticks) * us_per_tick,
+                             (double)e.dur * us_per_tick);
+            }
+        };
+        std::fputs("{\"traceEvents\":[", f);
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            for (const RetiredTrace& r : retired_traces) dump(r.tid, r.name, r.events);
+            for (ThreadProf* tp : live) {
+                std::lock_guard<std::mutex> tl(tp->trace_mu);
+                if (!tp->trace.empty()) dump(tp->tid, tp->name, tp->trace);
+            }
+        }
+        std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", f);
+        return std::fclose(f) == 0;
     }
 };
 
+// Never destroyed: threads owned by other statics (the logger's flusher)
+// detach from it during static destruction.
+Profiler& profiler() {
+    static Profiler* p = new Profiler();
+    return *p;
+}
+
+void Profiler::profiler_detach(ThreadProf* tp) { profiler().detach(tp); }
+
+struct ProfScope {
+    Profiler::ThreadProf& tp;
+    Phase phase;
+    uint64_t start;
+    uint64_t outer_child;
+
+    explicit ProfScope(Phase p)
+      : tp(profiler().local()), phase(p), start(prof_ticks()), outer_child(tp.child) {
+        tp.child = 0;
+    }
+    ~ProfScope() {
+        uint64_t total = prof_ticks() - start;
+        tp.charge(phase, total - std::min(total, tp.child));
+        tp.child = outer_child + total;
+        if (profiler().tracing.load(std::memory_order_relaxed))
+            profiler().record(tp, phase, start, total);
+    }
+};
+
+#ifndef DISPATCHER_NO_PROFILE
+#define PROF_CONCAT2(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT2(a, b)
+#define PROF_SCOPE(phase) ProfScope PROF_CONCAT(prof_scope_, __LINE__)(phase)
+#define PROF_THREAD(name) profiler().name_thread(name)
+#else
+#define PROF_SCOPE(phase) ((void)0)
+#define PROF_THREAD(name) ((void)0)
+#endif
+
 // --------------------------- Domain ---------------------------
+// Rejected and Dropped are terminal without an attempt: turned away at
+// admission, or shed from a full queue (--max-queue).
+enum class JobStatus : uint8_t { Pending, Running, Success, Failed, Rejected, Dropped };
+
+const char* status_str(JobStatus s) {
+    switch (s) {
+        case JobStatus::Pending: return "PENDING";
+        case JobStatus::Running: return "RUNNING";
+        case JobStatus::Success: return "SUCCESS";
+        case JobStatus::Failed:  return "FAILED";
+        case JobStatus::Rejected: return "REJECTED";
+        case JobStatus::Dropped: return "DROPPED";
+    }
+    return "UNKNOWN";
+}
+
+// Interned fail_reason strings. Jobs carry a 16-bit code and the text is
+// looked up only when a row is written or logged. std::deque keeps the
+// returned references stable while new reasons are interned. Executors may
+// report arbitrary text, so past kMaxReasons distinct strings new ones fold
+// into OTHER_FAILURE.
+enum : uint16_t { kReasonNone = 0, kReasonSimulated = 1, kReasonOther = 2, kReasonDuplicate = 3 };
+
+struct ReasonTable {
+    static constexpr size_t kMaxReasons = 4096;
+
+    std::mutex mu;
+    std::deque<std::string> names{"", "SIMULATED_FAILURE", "OTHER_FAILURE", "DUPLICATE"};
+    std::unordered_map<std::string, uint16_t> ids{{"", kReasonNone},
+                                                 {"SIMULATED_FAILURE", kReasonSimulated},
+                                                 {"OTHER_FAILURE", kReasonOther},
+                                                 {"DUPLICATE", kReasonDuplicate}};
+
+    uint16_t intern(const std::string& s) {
+        std::lock_guard<std::mutex> lk(mu);
+        auto it = ids.find(s);
+        if (it != ids.end()) return it->second;
+        if (names.size() >= kMaxReasons) return kReasonOther;
+        uint16_t id = (uint16_t)names.size();
+        names.push_back(s);
+        ids.emplace(s, id);
+        return id;
+    }
+    const std::string& name(uint16_t id) {
+        std::lock_guard<std::mutex> lk(mu);
+        return id < names.size() ? names[id] : names[kReasonNone];
+    }
+    size_t size() {
+        std::lock_guard<std::mutex> lk(mu);
+        return names.size();
+    }
+};
+
+ReasonTable& reasons() {
+    static ReasonTable t;
+    return t;
+}
+
+constexpr int64_t kNoTs = -1;   // start_ts/end_ts not reached yet
+
+// Trivially copyable and no larger than a cache line, so heap sifts and the
+// record queue move plain bytes instead of strings.
 struct Job {
-    int ext_id;             // external ID (1..N)
-    int priority;           // higher = sooner
-    int attempt = 0;        // current attempt
-    int max_retries;        // cap
-    int64_t enqueue_ts;     // when enqueued (ms)
-    std::optional<int64_t> start_ts;
-    std::optional<int64_t> end_ts;
-    int wait_ms = 0;
-    int service_ms = 0;
-    int turnaround_ms = 0;
-    std::string status = "PENDING";  // PENDING/RUNNING/SUCCESS/FAILED
-    std::string fail_reason;
+    int64_t enqueue_ts = 0;     // when enqueued (ms)
+    int64_t deadline_ts = 0;    // absolute deadline (ms), used by --policy edf
+    int64_t start_ts = kNoTs;
+    int64_t end_ts = kNoTs;
+    int32_t ext_id = 0;         // external ID (1..N)
+    int32_t wait_ms = 0;
+    int32_t service_ms = 0;
+    int32_t turnaround_ms = 0;
+    int32_t spec_service_ms = 0; // from the input trace; 0 = sample per attempt
+    int32_t since_first_ms = 0; // first enqueue_ts to the current one (retries)
+    int16_t priority = 0;       // higher = sooner
+    uint8_t attempt = 0;        // current attempt
+    uint8_t max_retries = 0;    // cap
+    uint16_t fail_reason = kReasonNone;
+    JobStatus status = JobStatus::Pending;
+    uint8_t mlfq_level = 0;     // used by --policy mlfq
+};
+static_assert(std::is_trivially_copyable<Job>::value, "Job must stay trivially copyable");
+static_assert(sizeof(Job) <= 64, "Job grew past one cache line");
+
+// What the scheduler orders instead of whole Jobs: the sort keys plus the
+// job's JobPool index, so heap sifts move 16 bytes rather than 64.
+struct JobRef {
+    int64_t ts;         // enqueue_ts
+    uint32_t idx;
+    int16_t priority;
 };
 
 struct JobCmp {
@@ -89,294 +618,4550 @@ struct JobCmp {
         if (a.priority != b.priority) return a.priority < b.priority;
         return a.enqueue_ts > b.enqueue_ts;
     }
+    bool operator()(JobRef const& a, JobRef const& b) const {
+        if (a.priority != b.priority) return a.priority < b.priority;
+        return a.ts > b.ts;
+    }
 };
 
-// --------------------------- SQLite helpers ---------------------------
-struct DB {
-    sqlite3* db = nullptr;
-    explicit DB(const std::string& path) {
-        if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
-            std::cerr << "Failed to open DB: " << sqlite3_errmsg(db) << "\n";
-            std::exit(1);
+// --------------------------- Job pool ---------------------------
+// Stable storage for every unfinished job. A job is acquired when admitted
+// and released once terminal; in between, the scheduler, the retry timer
+// and the event heap pass its 32-bit index around, so no Job is copied on
+// the dispatch path. Slots live in fixed chunks that never move, and freed
+// indices are reused, so once the pool has grown to the peak number of live
+// jobs it stops allocating.
+//
+// Index hand-off between threads goes through the scheduler's (or timer's)
+// locks, which orders a slot's writes before the next owner's reads.
+struct JobPool {
+    static constexpr int kChunkBits = 12;
+    static constexpr uint32_t kChunk = 1u << kChunkBits;   // 256KB of Jobs
+    static constexpr uint32_t kMaxChunks = 1u << 14;       // 64M live jobs
+
+    std::vector<std::unique_ptr<Job[]>> chunks;
+    std::mutex mu;                  // guards free_list, used, chunk creation
+    std::vector<uint32_t> free_list;
+    uint32_t used = 0;              // indices handed out at least once
+
+    JobPool() : chunks(kMaxChunks) {}
+
+    uint32_t acquire() {
+        std::lock_guard<std::mutex> lk(mu);
+        if (!free_list.empty()) {
+            uint32_t idx = free_list.back();
+            free_list.pop_back();
+            return idx;
+        }
+        if ((used & (kChunk - 1)) == 0) {
+            if ((used >> kChunkBits) >= kMaxChunks) {
+                std::cerr << "Job pool exhausted (" << used << " live jobs)\n";
+                std::exit(1);
+            }
+            chunks[used >> kChunkBits].reset(new Job[kChunk]);
+            free_list.reserve(used + kChunk); // so release() never allocates
         }
-        exec("PRAGMA journal_mode=WAL;");
-        exec("PRAGMA synchronous=NORMAL;");
-        create_schema();
+        return used++;
     }
-    ~DB(){ if (db) sqlite3_close(db); }
 
-    void exec(const std::string& sql) {
-        char* err = nullptr;
-        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
-            std::string m = err ? err : "unknown";
-            sqlite3_free(err);
-            std::cerr << "SQL error: " << m << "\n";
+    // n never-used slots with consecutive indices, for bulk seeding. Their
+    // chunks exist on return, so other threads may fill them unlocked.
+    uint32_t acquire_run(uint32_t n) {
+        std::lock_guard<std::mutex> lk(mu);
+        if ((uint64_t)used + n > (uint64_t)kMaxChunks << kChunkBits) {
+            std::cerr << "Job pool exhausted (" << (uint64_t)used + n << " live jobs)\n";
             std::exit(1);
         }
+        uint32_t first = used;
+        for (uint32_t c = (used + kChunk - 1) >> kChunkBits; c << kChunkBits < used + n; ++c)
+            chunks[c].reset(new Job[kChunk]);
+        used += n;
+        free_list.reserve(used + kChunk);
+        return first;
     }
 
-    void create_schema() {
-        exec(R"SQL(
-        CREATE TABLE IF NOT EXISTS runs(
-          run_id INTEGER PRIMARY KEY AUTOINCREMENT,
-          started_at INTEGER,
-          finished_at INTEGER,
-          total_jobs INTEGER,
-          success_jobs INTEGER,
-          failed_jobs INTEGER,
-          avg_wait_ms REAL,
-          avg_service_ms REAL,
-          avg_turnaround_ms REAL,
-          throughput_jobs_per_s REAL
-        );
-        CREATE TABLE IF NOT EXISTS jobs(
-          job_id INTEGER PRIMARY KEY AUTOINCREMENT,
-          run_id INTEGER,
-          ext_id INTEGER,
-          priority INTEGER,
-          attempt INTEGER,
-          status TEXT,
-          fail_reason TEXT,
-          enqueue_ts INTEGER,
-          start_ts INTEGER,
-          end_ts INTEGER,
-          wait_ms INTEGER,
-          service_ms INTEGER,
-          turnaround_ms INTEGER
-        );
-        )SQL");
+    void release(uint32_t idx) {
+        std::lock_guard<std::mutex> lk(mu);
+        free_list.push_back(idx);
     }
-};
 
-struct RunRecorder {
-    DB& db;
-    sqlite3_stmt* ins_job = nullptr;
-    sqlite3_stmt* ins_run = nullptr;
-    int64_t run_start_ms = 0;
-    int64_t run_end_ms = 0;
-    int run_id = 0;
+    Job& operator[](uint32_t idx) { return chunks[idx >> kChunkBits][idx & (kChunk - 1)]; }
+};
 
-    explicit RunRecorder(DB& d) : db(d) {
-        prepare();
+// --------------------------- Scheduler ---------------------------
+// Ordering policy behind Scheduler. Each policy owns its storage and its
+// locking; Scheduler adds the shared size count and the idle wait. Policies
+// order pool indices; push() gets the job itself to read its keys.
+struct SchedPolicy {
+    virtual ~SchedPolicy() = default;
+    virtual const char* name() const = 0;
+    virtual void push(Job& j, uint32_t idx) = 0;
+    // Pushes slots [first, first + n): appended unsorted, then each heap is
+    // rebuilt once, O(n) rather than n sifting pushes.
+    virtual void push_bulk(JobPool& pool, uint32_t first, uint32_t n) {
+        for (uint32_t i = first; i < first + n; ++i) push(pool[i], i);
     }
-    ~RunRecorder() {
-        if (ins_job) sqlite3_finalize(ins_job);
-        if (ins_run) sqlite3_finalize(ins_run);
+    virtual bool try_pop(uint32_t& idx) = 0;
+    // Pops up to k indices into out in policy order and returns how many.
+    // Policies override this to take the whole batch under one lock.
+    virtual size_t try_pop_batch(uint32_t* out, size_t k) {
+        size_t n = 0;
+        while (n < k && try_pop(out[n])) ++n;
+        return n;
     }
-    void prepare() {
-        const char* job_sql =
-          "INSERT INTO jobs(run_id,ext_id,priority,attempt,status,fail_reason,"
-          "enqueue_ts,start_ts,end_ts,wait_ms,service_ms,turnaround_ms)"
-          " VALUES(?,?,?,?,?,?,?,?,?,?,?,?);";
-        if (sqlite3_prepare_v2(db.db, job_sql, -1, &ins_job, nullptr) != SQLITE_OK)
-            die("prepare ins_job");
+    // --overload shed: if a queued job ranks below `incoming` under JobCmp,
+    // removes the lowest-ranked one, stores its index in out and returns
+    // true. Otherwise `incoming` is the one to drop.
+    virtual bool shed_below(const JobRef& incoming, uint32_t& out) = 0;
+};
 
-        const char* run_sql =
-          "INSERT INTO runs(started_at,finished_at,total_jobs,success_jobs,failed_jobs,"
-          "avg_wait_ms,avg_service_ms,avg_turnaround_ms,throughput_jobs_per_s)"
-          " VALUES(?,?,?,?,?,?,?,?,?);";
-        if (sqlite3_prepare_v2(db.db, run_sql, -1, &ins_run, nullptr) != SQLITE_OK)
-            die("prepare ins_run");
+// priority_queue that can also remove its lowest element under some other
+// order, for shedding. When that order is the heap's own, the lowest is a
+// leaf, so only the bottom half is scanned and one sift-up repairs the heap;
+// otherwise it is a full scan and rebuild. Both only run on overload.
+template <class T, class Cmp>
+struct ShedHeap : std::priority_queue<T, std::vector<T>, Cmp> {
+    static constexpr size_t kNone = SIZE_MAX;
+
+    template <class Less>
+    size_t lowest(Less less, bool leaves_only) const {
+        const std::vector<T>& c = this->c;
+        if (c.empty()) return kNone;
+        size_t best = leaves_only ? c.size() / 2 : 0;
+        for (size_t i = best + 1; i < c.size(); ++i)
+            if (less(c[i], c[best])) best = i;
+        return best;
     }
-    [[noreturn]] void die(const char* where) {
-        std::cerr << where << " : " << sqlite3_errmsg(db.db) << "\n";
-        std::exit(1);
+    const T& at(size_t i) const { return this->c[i]; }
+
+    // Bulk loading: append() breaks the heap order until heapify() restores
+    // it in O(size).
+    void reserve(size_t n) { this->c.reserve(n); }
+    void append(const T& v) { this->c.push_back(v); }
+    void heapify() { std::make_heap(this->c.begin(), this->c.end(), this->comp); }
+
+    T remove_at(size_t i, bool leaf) {
+        std::vector<T>& c = this->c;
+        T out = c[i];
+        c[i] = c.back();
+        c.pop_back();
+        if (i < c.size()) {
+            if (leaf) std::push_heap(c.begin(), c.begin() + (std::ptrdiff_t)i + 1, this->comp);
+            else std::make_heap(c.begin(), c.end(), this->comp);
+        }
+        return out;
     }
+};
 
-    void begin() { run_start_ms = now_ms(); }
-    void end()   { run_end_ms   = now_ms(); }
+using JobHeap = ShedHeap<JobRef, JobCmp>;
 
-    void record_job(const Job& j) {
-        auto bind_text = [&](int idx, const std::string& s){
-            if (sqlite3_bind_text(ins_job, idx, s.c_str(), (int)s.size(), SQLITE_TRANSIENT) != SQLITE_OK) die("bind_text");
-        };
-        auto bind_int = [&](int idx, int v){
-            if (sqlite3_bind_int(ins_job, idx, v) != SQLITE_OK) die("bind_int");
-        };
-        auto bind_i64 = [&](int idx, int64_t v){
-            if (sqlite3_bind_int64(ins_job, idx, (sqlite3_int64)v) != SQLITE_OK) die("bind_i64");
-        };
+// Shedding for a heap ordered by JobCmp: takes its lowest job if that ranks
+// below `incoming`.
+bool shed_from(JobHeap& h, const JobRef& incoming, uint32_t& out) {
+    size_t i = h.lowest(JobCmp(), true);
+    if (i == JobHeap::kNone || !JobCmp()(h.at(i), incoming)) return false;
+    out = h.remove_at(i, true).idx;
+    return true;
+}
 
-        bind_int(1, run_id);
-        bind_int(2, j.ext_id);
-        bind_int(3, j.priority);
-        bind_int(4, j.attempt);
-        bind_text(5, j.status);
-        bind_text(6, j.fail_reason);
-        bind_i64(7, j.enqueue_ts);
-        bind_i64(8, j.start_ts.value_or(0));
-        bind_i64(9, j.end_ts.value_or(0));
-        bind_int(10, j.wait_ms);
-        bind_int(11, j.service_ms);
-        bind_int(12, j.turnaround_ms);
+int priority_level(int priority, int levels) {
+    return std::min(levels, std::max(1, priority)) - 1;
+}
 
-        if (sqlite3_step(ins_job) != SQLITE_DONE) die("step ins_job");
-        sqlite3_reset(ins_job);
-        sqlite3_clear_bindings(ins_job);
-    }
+// strict: JobCmp order (higher priority first, then FIFO), sharded into one
+// heap per priority level (RNG::prio_dist yields 1..10). Each level has its
+// own lock and a bitmap of non-empty levels lets pop find the highest ready
+// level without touching the others, so workers popping different levels
+// and retries pushing into other levels do not serialize on one heap.
+struct StrictPriorityPolicy : SchedPolicy {
+    static constexpr int kLevels = 10;
 
-    void record_run_summary(int total, int succ, int fail,
-                            double avg_wait, double avg_service, double avg_turn,
-                            double throughput) {
-        auto bind_i64 = [&](int idx, int64_t v){
-            if (sqlite3_bind_int64(ins_run, idx, (sqlite3_int64)v) != SQLITE_OK) die("bind i64 run");
-        };
-        auto bind_int = [&](int idx, int v){
-            if (sqlite3_bind_int(ins_run, idx, v) != SQLITE_OK) die("bind int run");
-        };
-        auto bind_d = [&](int idx, double v){
-            if (sqlite3_bind_double(ins_run, idx, v) != SQLITE_OK) die("bind dbl run");
-        };
+    struct alignas(64) Level {
+        std::mutex mu;
+        JobHeap heap;
+    };
+    Level levels[kLevels];
+    std::atomic<uint32_t> nonempty{0};  // bit L set <=> levels[L] has jobs
 
-        bind_i64(1, run_start_ms);
-        bind_i64(2, run_end_ms);
-        bind_int(3, total);
-        bind_int(4, succ);
-        bind_int(5, fail);
-        bind_d(6, avg_wait);
-        bind_d(7, avg_service);
-        bind_d(8, avg_turn);
-        bind_d(9, throughput);
+    const char* name() const override { return "strict"; }
 
-        if (sqlite3_step(ins_run) != SQLITE_DONE) die("step ins_run");
-        run_id = (int)sqlite3_last_insert_rowid(db.db);
-        sqlite3_reset(ins_run);
-        sqlite3_clear_bindings(ins_run);
+    void push(Job& j, uint32_t idx) override {
+        int lvl = priority_level(j.priority, kLevels);
+        Level& L = levels[lvl];
+        std::lock_guard<std::mutex> lk(L.mu);
+        L.heap.push(JobRef{j.enqueue_ts, idx, j.priority});
+        nonempty.fetch_or(1u << lvl);
     }
-};
 
-// --------------------------- Dispatcher ---------------------------
-struct Dispatcher {
-    Args args;
-    RNG rng;
-    DB db;
-    RunRecorder rec;
+    void push_bulk(JobPool& pool, uint32_t first, uint32_t n) override {
+        std::unique_lock<std::mutex> lks[kLevels];
+        for (int l = 0; l < kLevels; ++l) lks[l] = std::unique_lock<std::mutex>(levels[l].mu);
+        uint32_t touched = 0;
+        for (uint32_t i = first; i < first + n; ++i) {
+            const Job& j = pool[i];
+            int lvl = priority_level(j.priority, kLevels);
+            levels[lvl].heap.append(JobRef{j.enqueue_ts, i, j.priority});
+            touched |= 1u << lvl;
+        }
+        for (int l = 0; l < kLevels; ++l)
+            if (touched & (1u << l)) levels[l].heap.heapify();
+        nonempty.fetch_or(touched);
+    }
 
-    std::priority_queue<Job, std::vector<Job>, JobCmp> pq;
-    std::vector<Job> completed;
+    bool try_pop(uint32_t& idx) override {
+        for (;;) {
+            uint32_t mask = nonempty.load();
+            if (!mask) return false;
+            int lvl = kLevels - 1;
+            while (!(mask & (1u << lvl))) --lvl;
 
-    Dispatcher(const Args& a)
-      : args(a), rng(a.mean_ms, a.stddev_ms), db(a.db), rec(db) {}
+            Level& L = levels[lvl];
+            std::lock_guard<std::mutex> lk(L.mu);
+            if (L.heap.empty()) continue; // raced with another pop; reload mask
+            idx = L.heap.top().idx;
+            L.heap.pop();
+            if (L.heap.empty()) nonempty.fetch_and(~(1u << lvl));
+            return true;
+        }
+    }
 
-    void seed_jobs() {
-        int64_t t0 = now_ms();
-        for (int i = 1; i <= args.jobs; ++i) {
-            Job j;
-            j.ext_id = i;
-            j.priority = rng.priority();
-            j.max_retries = args.max_retries;
-            j.enqueue_ts = t0 + i; // stable ordering
-            pq.push(j);
+    // Drains the highest ready level under its lock, then moves down a
+    // level, so a batch takes one lock per level it touches.
+    size_t try_pop_batch(uint32_t* out, size_t k) override {
+        size_t n = 0;
+        while (n < k) {
+            uint32_t mask = nonempty.load();
+            if (!mask) break;
+            int lvl = kLevels - 1;
+            while (!(mask & (1u << lvl))) --lvl;
+
+            Level& L = levels[lvl];
+            std::lock_guard<std::mutex> lk(L.mu);
+            while (n < k && !L.heap.empty()) {
+                out[n++] = L.heap.top().idx;
+                L.heap.pop();
+            }
+            if (L.heap.empty()) nonempty.fetch_and(~(1u << lvl));
         }
+        return n;
     }
 
-    void maybe_backoff(Job& j) {
-        if (j.attempt == 0) return;
-        // exponential backoff: 100ms, 200ms, 400ms...
-        int backoff = 100 << (j.attempt - 1);
-        std::this_thread::sleep_for(Ms(backoff));
+    // Only the lowest non-empty level can hold the lowest job.
+    bool shed_below(const JobRef& incoming, uint32_t& out) override {
+        uint32_t mask = nonempty.load();
+        if (!mask) return false;
+        int lvl = 0;
+        while (!(mask & (1u << lvl))) ++lvl;
+        if (lvl > priority_level(incoming.priority, kLevels)) return false;
+        Level& L = levels[lvl];
+        std::lock_guard<std::mutex> lk(L.mu);
+        if (!shed_from(L.heap, incoming, out)) return false;
+        if (L.heap.empty()) nonempty.fetch_and(~(1u << lvl));
+        return true;
     }
+};
 
-    void run() {
-        rec.begin();
-        seed_jobs();
-        auto wall_start = Clock::now();
+// wfq: weighted fair queuing across the ten priority classes, weight =
+// priority. Stride scheduling: each class keeps a pass value advanced by
+// kStride/weight per dispatch and the non-empty class with the lowest pass
+// goes next, so a priority-1 class still gets 1/55 of dispatches under full
+// load instead of starving. O(kLevels) select plus O(log n) within a class.
+struct WeightedFairPolicy : SchedPolicy {
+    static constexpr int kLevels = 10;
+    static constexpr uint64_t kStride = 2520;   // divisible by 1..10
+
+    std::mutex mu;
+    JobHeap classes[kLevels];
+    uint64_t pass[kLevels] = {};
+    uint64_t vtime = 0;     // pass of the last dispatched class
+
+    const char* name() const override { return "wfq"; }
 
-        int successes = 0, failures = 0;
-        int64_t total_wait = 0, total_service = 0, total_turn = 0;
+    void push(Job& j, uint32_t idx) override {
+        int c = priority_level(j.priority, kLevels);
+        std::lock_guard<std::mutex> lk(mu);
+        // An idle class rejoins at the current virtual time rather than
+        // cashing in credit it built up while empty.
+        if (classes[c].empty()) pass[c] = std::max(pass[c], vtime);
+        classes[c].push(JobRef{j.enqueue_ts, idx, j.priority});
+    }
 
-        while (!pq.empty()) {
-            Job j = pq.top(); pq.pop();
+    void push_bulk(JobPool& pool, uint32_t first, uint32_t n) override {
+        std::lock_guard<std::mutex> lk(mu);
+        for (int c = 0; c < kLevels; ++c)
+            if (classes[c].empty()) pass[c] = std::max(pass[c], vtime);
+        for (uint32_t i = first; i < first + n; ++i) {
+            const Job& j = pool[i];
+            classes[priority_level(j.priority, kLevels)].append(JobRef{j.enqueue_ts, i, j.priority});
+        }
+        for (auto& h : classes) h.heapify();
+    }
 
-            maybe_backoff(j);
+    bool try_pop(uint32_t& idx) override {
+        std::lock_guard<std::mutex> lk(mu);
+        return pop_locked(idx);
+    }
 
-            j.start_ts = now_ms();
-            j.status = "RUNNING";
-            j.wait_ms = (int)(*j.start_ts - j.enqueue_ts);
+    size_t try_pop_batch(uint32_t* out, size_t k) override {
+        std::lock_guard<std::mutex> lk(mu);
+        size_t n = 0;
+        while (n < k && pop_locked(out[n])) ++n;
+        return n;
+    }
 
-            int svc = rng.service_ms();
-            j.service_ms = svc;
-            std::this_thread::sleep_for(Ms(svc));
+    bool shed_below(const JobRef& incoming, uint32_t& out) override {
+        std::lock_guard<std::mutex> lk(mu);
+        for (int c = 0; c < kLevels; ++c)
+            if (!classes[c].empty()) return shed_from(classes[c], incoming, out);
+        return false;
+    }
 
-            bool fail = rng.should_fail(j.attempt);
-            j.end_ts = now_ms();
-            j.turnaround_ms = (int)(*j.end_ts - j.enqueue_ts);
+    bool pop_locked(uint32_t& idx) {
+        int best = -1;
+        for (int c = kLevels - 1; c >= 0; --c)
+            if (!classes[c].empty() && (best < 0 || pass[c] < pass[best])) best = c;
+        if (best < 0) return false;
+        idx = classes[best].top().idx;
+        classes[best].pop();
+        vtime = pass[best];
+        pass[best] += kStride / (uint64_t)(best + 1);
+        return true;
+    }
+};
 
-            if (!fail) {
-                j.status = "SUCCESS";
-                successes++;
-                total_wait += j.wait_ms;
-                total_service += j.service_ms;
-                total_turn += j.turnaround_ms;
-                rec.record_job(j);
-                completed.push_back(j);
-                log_console(j);
-            } else {
-                j.status = "FAILED";
-                j.fail_reason = "SIMULATED_FAILURE";
-                rec.record_job(j);
-                log_console(j);
-
-                if (j.attempt < j.max_retries) {
-                    j.attempt += 1;
-                    j.status = "PENDING";
-                    // Re-enqueue with slight priority aging to avoid starvation
-                    j.priority = std::min(10, j.priority + 1);
-                    j.enqueue_ts = now_ms();
-                    pq.push(j);
-                } else {
-                    failures++;
-                    completed.push_back(j);
-                }
-            }
+// edf: earliest absolute deadline first (Job::deadline_ts), ties by JobCmp.
+struct EdfPolicy : SchedPolicy {
+    struct Entry {
+        int64_t deadline_ts;
+        JobRef ref;
+    };
+    struct Later {
+        bool operator()(Entry const& a, Entry const& b) const {
+            if (a.deadline_ts != b.deadline_ts) return a.deadline_ts > b.deadline_ts;
+            return JobCmp{}(a.ref, b.ref);
         }
+    };
+    std::mutex mu;
+    ShedHeap<Entry, Later> heap;
 
-        rec.end();
-        double seconds = std::max(0.001,
-            std::chrono::duration<double>(Clock::now() - wall_start).count());
-        int total = successes + failures;
+    const char* name() const override { return "edf"; }
+
+    void push(Job& j, uint32_t idx) override {
+        std::lock_guard<std::mutex> lk(mu);
+        heap.push(Entry{j.deadline_ts, JobRef{j.enqueue_ts, idx, j.priority}});
+    }
 
-        double avg_wait = total ? (double)total_wait / total : 0.0;
-        double avg_service = total ? (double)total_service / total : 0.0;
-        double avg_turn = total ? (double)total_turn / total : 0.0;
-        double throughput = seconds > 0 ? (double)successes / seconds : 0.0;
+    void push_bulk(JobPool& pool, uint32_t first, uint32_t n) override {
+        std::lock_guard<std::mutex> lk(mu);
+        heap.reserve(heap.size() + n);
+        for (uint32_t i = first; i < first + n; ++i) {
+            const Job& j = pool[i];
+            heap.append(Entry{j.deadline_ts, JobRef{j.enqueue_ts, i, j.priority}});
+        }
+        heap.heapify();
+    }
 
-        rec.record_run_summary(total, successes, failures,
-                               avg_wait, avg_service, avg_turn, throughput);
+    bool try_pop(uint32_t& idx) override {
+        std::lock_guard<std::mutex> lk(mu);
+        if (heap.empty()) return false;
+        idx = heap.top().ref.idx;
+        heap.pop();
+        return true;
+    }
 
-        std::cout << "\n=== RUN SUMMARY ===\n"
-                  << "Total jobs: " << total << "\n"
-                  << "Success:    " << successes << "\n"
-                  << "Failed:     " << failures << "\n"
-                  << "Avg Wait:   " << std::fixed << std::setprecision(2) << avg_wait << " ms\n"
-                  << "Avg Service:" << avg_service << " ms\n"
-                  << "Avg Turn:   " << avg_turn << " ms\n"
-                  << "Throughput: " << throughput << " jobs/s\n";
+    size_t try_pop_batch(uint32_t* out, size_t k) override {
+        std::lock_guard<std::mutex> lk(mu);
+        size_t n = 0;
+        for (; n < k && !heap.empty(); ++n) {
+            out[n] = heap.top().ref.idx;
+            heap.pop();
+        }
+        return n;
     }
 
-    void log_console(const Job& j) {
-        std::cout << "[Job " << j.ext_id
-                  << " | prio=" << j.priority
-                  << " | att=" << j.attempt
-                  << "] wait=" << j.wait_ms
-                  << "ms, service=" << j.service_ms
-                  << "ms, turn=" << j.turnaround_ms
-                  << "ms -> " << j.status;
-        if (!j.fail_reason.empty()) std::cout << " (" << j.fail_reason << ")";
-        std::cout << "\n";
+    // Sheds by JobCmp, not by deadline, so this scans the whole heap.
+    bool shed_below(const JobRef& incoming, uint32_t& out) override {
+        std::lock_guard<std::mutex> lk(mu);
+        auto less = [](const Entry& a, const Entry& b){ return JobCmp()(a.ref, b.ref); };
+        size_t i = heap.lowest(less, false);
+        if (i == decltype(heap)::kNone || !JobCmp()(heap.at(i).ref, incoming)) return false;
+        out = heap.remove_at(i, false).ref.idx;
+        return true;
     }
 };
 
-// --------------------------- main ---------------------------
-int main(int argc, char** argv) {
-    Args args = parse_args(argc, argv);
+// mlfq: multi-level feedback queue. New jobs start in level 0 and every
+// retry sinks one level, so repeatedly failing jobs stop crowding out fresh
+// work. The demotion happens in finish_attempt() when it schedules the
+// retry; push() keeps the job's level, so a lost lease or a restored
+// journal row does not sink it again. Levels are FIFO by enqueue_ts (MLFQ
+// ignores the submitted priority). Pop serves the highest non-empty level,
+// except that a lower level whose oldest job has waited longer than
+// boost_ms goes first, which bounds how long a sunk job can starve.
+// O(kLevels) select plus O(log n) per level.
+struct MlfqPolicy : SchedPolicy {
+    static constexpr int kLevels = 4;
+
+    struct Older {
+        bool operator()(JobRef const& a, JobRef const& b) const {
+            if (a.ts != b.ts) return a.ts > b.ts;
+            return a.idx > b.idx;
+        }
+    };
+
+    const SimClock& clock;
+    int64_t boost_ms;
+    std::mutex mu;
+    ShedHeap<JobRef, Older> levels[kLevels];
+
+    MlfqPolicy(const SimClock& c, int boost) : clock(c), boost_ms(std::max(1, boost)) {}
+
+    const char* name() const override { return "mlfq"; }
+
+    void push(Job& j, uint32_t idx) override {
+        std::lock_guard<std::mutex> lk(mu);
+        levels[j.mlfq_level].push(JobRef{j.enqueue_ts, idx, j.priority});
+    }
 
-    std::cout << "Dispatcher starting with "
-              << args.jobs << " jobs, max_retries=" << args.max_retries
-              << ", mean=" << args.mean_ms << "ms, stddev=" << args.stddev_ms
-              << "ms, db=" << args.db << "\n";
+    void push_bulk(JobPool& pool, uint32_t first, uint32_t n) override {
+        std::lock_guard<std::mutex> lk(mu);
+        for (uint32_t i = first; i < first + n; ++i) {
+            Job& j = pool[i];
+            levels[j.mlfq_level].append(JobRef{j.enqueue_ts, i, j.priority});
+        }
+        for (auto& h : levels) h.heapify();
+    }
+
+    bool try_pop(uint32_t& idx) override {
+        std::lock_guard<std::mutex> lk(mu);
+        return pop_locked(idx, clock.now());
+    }
+
+    size_t try_pop_batch(uint32_t* out, size_t k) override {
+        std::lock_guard<std::mutex> lk(mu);
+        int64_t now = clock.now();
+        size_t n = 0;
+        while (n < k && pop_locked(out[n], now)) ++n;
+        return n;
+    }
+
+    // Levels are FIFO, so the lowest job by JobCmp can be anywhere.
+    bool shed_below(const JobRef& incoming, uint32_t& out) override {
+        std::lock_guard<std::mutex> lk(mu);
+        int lvl = -1;
+        size_t at = 0;
+        for (int l = 0; l < kLevels; ++l) {
+            size_t i = levels[l].lowest(JobCmp(), false);
+            if (i == ShedHeap<JobRef, Older>::kNone) continue;
+            if (lvl < 0 || JobCmp()(levels[l].at(i), levels[lvl].at(at))) { lvl = l; at = i; }
+        }
+        if (lvl < 0 || !JobCmp()(levels[lvl].at(at), incoming)) return false;
+        out = levels[lvl].remove_at(at, false).idx;
+        return true;
+    }
+
+    bool pop_locked(uint32_t& idx, int64_t now) {
+        int pick = -1;
+        for (int l = kLevels - 1; l > 0 && pick < 0; --l)
+            if (!levels[l].empty() && now - levels[l].top().ts > boost_ms) pick = l;
+        for (int l = 0; l < kLevels && pick < 0; ++l)
+            if (!levels[l].empty()) pick = l;
+        if (pick < 0) return false;
+        idx = levels[pick].top().idx;
+        levels[pick].pop();
+        return true;
+    }
+};
+
+std::unique_ptr<SchedPolicy> make_policy(const std::string& name, const SimClock& clock,
+                                         int mlfq_boost_ms) {
+    if (name == "strict") return std::unique_ptr<SchedPolicy>(new StrictPriorityPolicy());
+    if (name == "wfq") return std::unique_ptr<SchedPolicy>(new WeightedFairPolicy());
+    if (name == "edf") return std::unique_ptr<SchedPolicy>(new EdfPolicy());
+    if (name == "mlfq") return std::unique_ptr<SchedPolicy>(new MlfqPolicy(clock, mlfq_boost_ms));
+    std::cerr << "Unknown --policy: " << name << "\n";
+    std::exit(1);
+}
+
+// --------------------------- Dedup index ---------------------------
+// --dedup: ext_id -> where that job is (queued, running, backing off, done),
+// so a resubmitted ext_id is merged into the instance already in the system,
+// or rejected, instead of running twice. Each lookup is one hash probe under
+// one of kShards locks, picked by ext_id.
+//
+// A merged duplicate asking for a higher priority raises a queued job's
+// priority by lazy deletion rather than a heap rebuild: the job is copied
+// to a fresh pool slot that is pushed with the new priority, and the entry
+// points there. The old heap entry stays put; when it is popped, claim()
+// finds the entry no longer points at it and frees its slot. Running and
+// backing-off jobs keep the raise in `want` and take it when requeued.
+//
+// A terminal failure (or a job turned away) forgets the ext_id, so it can be
+// submitted again; a success is remembered and later duplicates merge into
+// it.
+struct DedupIndex {
+    enum class Mode { Off, Merge, Reject };
+    enum class State : uint8_t { Queued, Running, Backoff, Done };
+    enum class Admit { New, Merged, Rejected };
+    static constexpr int kShards = 16;
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+    struct Entry {
+        uint32_t idx;       // JobPool slot of the live copy; kNoSlot once done
+        State state;
+        int16_t want;       // highest priority asked for so far
+    };
+    struct alignas(64) Shard {
+        std::mutex mu;
+        std::unordered_map<int32_t, Entry> map;
+    };
+
+    Mode mode = Mode::Off;
+    bool raises = true;     // off for mlfq, which orders by age, not priority
+    Shard shards[kShards];
+    std::atomic<uint64_t> merged{0}, rejected{0}, raised{0};
+
+    static Mode parse_mode(const std::string& s) {
+        if (s == "off") return Mode::Off;
+        if (s == "merge") return Mode::Merge;
+        if (s == "reject") return Mode::Reject;
+        std::cerr << "Unknown --dedup: " << s << " (expected merge, reject or off)\n";
+        std::exit(1);
+    }
+    static const char* mode_str(Mode m) {
+        switch (m) {
+            case Mode::Off: return "off";
+            case Mode::Merge: return "merge";
+            case Mode::Reject: return "reject";
+        }
+        return "unknown";
+    }
+
+    Shard& shard(int32_t ext_id) { return shards[((uint32_t)ext_id * 2654435761u) >> 28]; }
+
+    // Admission of j, about to occupy `idx`. New: tracked as queued there.
+    // Otherwise the caller frees idx. Merging a higher priority into a queued
+    // instance calls raise(slot, priority), which returns the fresh slot.
+    template <class Raise>
+    Admit admit(const Job& j, uint32_t idx, Raise raise) {
+        Shard& s = shard(j.ext_id);
+        std::lock_guard<std::mutex> lk(s.mu);
+        auto ins = s.map.emplace(j.ext_id, Entry{idx, State::Queued, j.priority});
+        if (ins.second) return Admit::New;
+        Entry& e = ins.first->second;
+        if (mode == Mode::Reject) {
+            rejected.fetch_add(1, std::memory_order_relaxed);
+            return Admit::Rejected;
+        }
+        merged.fetch_add(1, std::memory_order_relaxed);
+        if (raises && j.priority > e.want && e.state != State::Done) {
+            e.want = j.priority;
+            if (e.state == State::Queued) {
+                e.idx = raise(e.idx, j.priority);
+                raised.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        return Admit::Merged;
+    }
+
+    // A popped slot: true if it is its job's live copy, now running. A stale
+    // copy left behind by a raise is released instead.
+    bool claim(JobPool& pool, uint32_t idx) {
+        int32_t id = pool[idx].ext_id;
+        Shard& s = shard(id);
+        {
+            std::lock_guard<std::mutex> lk(s.mu);
+            auto it = s.map.find(id);
+            if (it != s.map.end() && it->second.idx == idx && it->second.state == State::Queued) {
+                it->second.state = State::Running;
+                return true;
+            }
+        }
+        pool.release(idx);
+        return false;
+    }
+
+    // Back into the queue after a backoff or a lost lease, taking any raise
+    // merged in meanwhile. push() runs under the shard lock so a concurrent
+    // raise copies the job either before or after it is queued, never during.
+    template <class Push>
+    void requeue(Job& j, Push push) {
+        Shard& s = shard(j.ext_id);
+        std::lock_guard<std::mutex> lk(s.mu);
+        auto it = s.map.find(j.ext_id);
+        if (it != s.map.end()) {
+            it->second.state = State::Queued;
+            j.priority = std::max(j.priority, it->second.want);
+        }
+        push();
+    }
+
+    void set_state(int32_t ext_id, State st) {
+        Shard& s = shard(ext_id);
+        std::lock_guard<std::mutex> lk(s.mu);
+        auto it = s.map.find(ext_id);
+        if (it == s.map.end()) return;
+        it->second.state = st;
+        if (st == State::Done) it->second.idx = kNoSlot;
+    }
+
+    void forget(int32_t ext_id) {
+        Shard& s = shard(ext_id);
+        std::lock_guard<std::mutex> lk(s.mu);
+        s.map.erase(ext_id);
+    }
+};
+
+// Concurrent job queue shared by producers, workers and the retry timer.
+// Ordering comes from the SchedPolicy; this adds an approximate size and a
+// blocking pop for idle workers. Jobs go in and come out as indices into
+// `pool`. With `dedup` set, pops skip the stale copies raise() leaves
+// behind; those are not in `count`.
+struct Scheduler {
+    JobPool& pool;
+    std::unique_ptr<SchedPolicy> policy;
+    std::atomic<int64_t> count{0};
+    DedupIndex* dedup = nullptr;
+
+    std::mutex idle_mu;
+    std::condition_variable idle_cv;
+    std::atomic<int> idle_waiters{0};
+
+    explicit Scheduler(JobPool& jp, std::unique_ptr<SchedPolicy> p
+                           = std::unique_ptr<SchedPolicy>(new StrictPriorityPolicy()))
+      : pool(jp), policy(std::move(p)) {}
+
+    void push(uint32_t idx) {
+        PROF_SCOPE(Phase::Schedule);
+        policy->push(pool[idx], idx);
+        count.fetch_add(1);
+        if (idle_waiters.load() > 0) {
+            std::lock_guard<std::mutex> lk(idle_mu);
+            idle_cv.notify_one();
+        }
+    }
+
+    // Seeding: slots [first, first + n) in one go (SchedPolicy::push_bulk).
+    void push_bulk(uint32_t first, uint32_t n) {
+        PROF_SCOPE(Phase::Schedule);
+        policy->push_bulk(pool, first, n);
+        count.fetch_add(n);
+        if (idle_waiters.load() > 0) wake_all();
+    }
+
+    bool try_pop(uint32_t& out) {
+        PROF_SCOPE(Phase::Schedule);
+        do {
+            if (!policy->try_pop(out)) return false;
+        } while (dedup && !dedup->claim(pool, out));
+        count.fetch_sub(1);
+        return true;
+    }
+
+    // Takes up to k jobs in one call: one policy lock per batch (per level
+    // for strict) and one update of the shared count.
+    size_t pop_batch(uint32_t* out, size_t k) {
+        PROF_SCOPE(Phase::Schedule);
+        size_t n = policy->try_pop_batch(out, k);
+        while (dedup && n) {
+            size_t live = 0;
+            for (size_t i = 0; i < n; ++i)
+                if (dedup->claim(pool, out[i])) out[live++] = out[i];
+            if (live) { n = live; break; }
+            n = policy->try_pop_batch(out, k);   // all stale: try again
+        }
+        if (n) count.fetch_sub((int64_t)n);
+        return n;
+    }
+
+    // --overload shed: see SchedPolicy::shed_below.
+    bool shed_below(const Job& incoming, uint32_t& out) {
+        PROF_SCOPE(Phase::Schedule);
+        do {
+            if (!policy->shed_below(JobRef{incoming.enqueue_ts, UINT32_MAX, incoming.priority}, out))
+                return false;
+        } while (dedup && !dedup->claim(pool, out));
+        count.fetch_sub(1);
+        return true;
+    }
+
+    // --dedup merge: lazy decrease-key. Pushes a copy of queued slot idx
+    // with the higher priority and returns its slot; the old entry goes
+    // stale (see DedupIndex). The job was already counted.
+    uint32_t raise(uint32_t idx, int16_t priority) {
+        PROF_SCOPE(Phase::Schedule);
+        uint32_t fresh = pool.acquire();
+        pool[fresh] = pool[idx];
+        pool[fresh].priority = priority;
+        policy->push(pool[fresh], fresh);
+        return fresh;
+    }
+
+    // Blocks until a job is available or done() holds with nothing queued.
+    // Returns false in the latter case. Whoever makes done() true must call
+    // wake_all().
+    template <class Done>
+    bool pop_wait(uint32_t& out, Done done) {
+        for (;;) {
+            if (try_pop(out)) return true;
+            std::unique_lock<std::mutex> lk(idle_mu);
+            idle_waiters.fetch_add(1);
+            idle_cv.wait(lk, [&]{ return count.load() > 0 || done(); });
+            idle_waiters.fetch_sub(1);
+            if (count.load() == 0 && done()) return false;
+        }
+    }
+
+    // Batch form of pop_wait(): returns the number popped, 0 once done.
+    template <class Done>
+    size_t pop_wait_batch(uint32_t* out, size_t k, Done done) {
+        for (;;) {
+            if (size_t n = pop_batch(out, k)) return n;
+            std::unique_lock<std::mutex> lk(idle_mu);
+            idle_waiters.fetch_add(1);
+            idle_cv.wait(lk, [&]{ return count.load() > 0 || done(); });
+            idle_waiters.fetch_sub(1);
+            if (count.load() == 0 && done()) return 0;
+        }
+    }
+
+    // Like pop_wait() without the pop: returns once work is queued, done()
+    // holds, or timeout_ms has passed.
+    template <class Done>
+    void wait_for_work(int64_t timeout_ms, Done done) {
+        std::unique_lock<std::mutex> lk(idle_mu);
+        idle_waiters.fetch_add(1);
+        idle_cv.wait_for(lk, Ms(timeout_ms), [&]{ return count.load() > 0 || done(); });
+        idle_waiters.fetch_sub(1);
+    }
+
+    void wake_all() {
+        std::lock_guard<std::mutex> lk(idle_mu);
+        idle_cv.notify_all();
+    }
+
+    int64_t size() const { return count.load(); }
+    bool empty() const { return size() == 0; }
+};
+
+// --------------------------- Retry timer ---------------------------
+// Delay queue for jobs waiting out their retry backoff. Failed attempts are
+// parked here with a due time and a dedicated thread hands them back through
+// `fire` once the backoff expires, so no worker sleeps on a job's backoff
+// while ready work is queued behind it.
+struct RetryTimer {
+    struct Entry {
+        int64_t due_ms;
+        uint64_t seq;   // FIFO among equal due times
+        uint32_t idx;   // JobPool index
+    };
+    struct Later {
+        bool operator()(Entry const& a, Entry const& b) const {
+            if (a.due_ms != b.due_ms) return a.due_ms > b.due_ms;
+            return a.seq > b.seq;
+        }
+    };
+
+    std::priority_queue<Entry, std::vector<Entry>, Later> heap;
+    std::mutex mu;
+    std::condition_variable cv;
+    uint64_t next_seq = 0;
+    bool stopping = false;
+    std::thread th;
+
+    ~RetryTimer() { stop(); }
+
+    template <class Fire>
+    void start(Fire fire) {
+        stopping = false;
+        th = std::thread([this, fire]{
+            PROF_THREAD("retry-timer");
+            loop(fire);
+        });
+    }
+
+    void schedule(uint32_t idx, int64_t due_ms) {
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            heap.push(Entry{due_ms, next_seq++, idx});
+        }
+        cv.notify_one();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            stopping = true;
+        }
+        cv.notify_one();
+        if (th.joinable()) th.join();
+    }
+
+    template <class Fire>
+    void loop(Fire fire) {
+        std::unique_lock<std::mutex> lk(mu);
+        while (!stopping) {
+            if (heap.empty()) { cv.wait(lk); continue; }
+            int64_t wait = heap.top().due_ms - now_ms();
+            if (wait > 0) { cv.wait_for(lk, Ms(wait)); continue; }
+            uint32_t idx = heap.top().idx;
+            heap.pop();
+            lk.unlock();
+            {
+                PROF_SCOPE(Phase::Backoff);
+                fire(idx);
+            }
+            lk.lock();
+        }
+    }
+};
+
+// --------------------------- Retry policy ---------------------------
+// Whether a failed attempt is retried, and after how long.
+//   backoff  base_ms << (attempt - 1), capped at cap_ms, with jitter
+//            none         - exactly that
+//            full         - uniform in [0, backoff]
+//            decorrelated - uniform in [base_ms, 3 x previous delay], capped
+//            Draws hash (seed, ext_id, attempt), so runs stay reproducible.
+//   budget   retries may be at most `budget` of the attempts finished in the
+//            rolling window, plus kMinRetries so a quiet start can still
+//            retry.
+//   breaker  once the window holds kMinSamples outcomes with a failure rate
+//            of at least `threshold`, no failed job is retried for open_ms;
+//            it then closes, dropping what the window counted while it was
+//            open, and re-evaluates from the outcomes that follow.
+// A denied retry makes the job fail terminally. Budget and breaker share a
+// window of kBuckets time buckets on the dispatcher clock; with both off the
+// policy takes no lock.
+struct RetryPolicy {
+    enum class Jitter { None, Full, Decorrelated };
+    enum class Verdict { Retry, NoBudget, BreakerOpen };
+    static constexpr int kBuckets = 10;
+    static constexpr int64_t kMinRetries = 10;
+    static constexpr int64_t kMinSamples = 20;
+
+    Jitter jitter = Jitter::None;
+    int base_ms = 100;
+    int cap_ms = 60000;
+    uint64_t seed = 0;
+    double budget = 0;          // 0 = unlimited
+    double threshold = 0;       // 0 = no breaker
+    int64_t window_ms = 10000;
+    int64_t open_ms = 5000;
+    int64_t t0 = 0;             // run start; buckets align to it, not to the wall clock
+
+    struct Bucket {
+        int64_t epoch = -1;     // which bucket_ms-long slot of time this counts
+        int64_t attempts = 0, failures = 0, retries = 0;
+    };
+    std::mutex mu;              // guards buckets, open_until and open
+    Bucket buckets[kBuckets];
+    int64_t open_until = INT64_MIN;
+    bool open = false;          // tripped and not yet closed by an outcome
+
+    std::atomic<uint64_t> retried{0}, denied_budget{0}, denied_breaker{0}, breaker_opens{0};
+
+    static Jitter parse_jitter(const std::string& s) {
+        if (s == "none") return Jitter::None;
+        if (s == "full") return Jitter::Full;
+        if (s == "decorrelated") return Jitter::Decorrelated;
+        std::cerr << "Unknown --jitter: " << s << " (expected none, full or decorrelated)\n";
+        std::exit(1);
+    }
+    static const char* jitter_str(Jitter j) {
+        switch (j) {
+            case Jitter::None: return "none";
+            case Jitter::Full: return "full";
+            case Jitter::Decorrelated: return "decorrelated";
+        }
+        return "unknown";
+    }
+
+    bool windowed() const { return budget > 0 || threshold > 0; }
+    int64_t bucket_ms() const { return std::max<int64_t>(1, window_ms / kBuckets); }
+
+    // Uniform in [lo, hi] from the job's attempt.
+    int64_t draw(const Job& j, int attempt, int64_t lo, int64_t hi) const {
+        if (hi <= lo) return lo;
+        uint64_t x = seed ^ ((uint64_t)(uint32_t)j.ext_id << 32 | (uint32_t)attempt) ^ 0x6a09e667f3bcc909ULL;
+        return lo + (int64_t)(splitmix64(x) % (uint64_t)(hi - lo + 1));
+    }
+
+    // Delay before retry number j.attempt (already incremented).
+    int backoff_ms(const Job& j) const {
+        int64_t cap = cap_ms > 0 ? cap_ms : INT32_MAX;
+        int64_t exp = std::min<int64_t>(cap, (int64_t)base_ms << std::min(j.attempt - 1, 30));
+        switch (jitter) {
+            case Jitter::None: return (int)exp;
+            case Jitter::Full: return (int)draw(j, j.attempt, 0, exp);
+            case Jitter::Decorrelated: {
+                int64_t d = base_ms;
+                for (int a = 1; a <= j.attempt; ++a)
+                    d = std::min(cap, draw(j, a, base_ms, 3 * d));
+                return (int)d;
+            }
+        }
+        return (int)exp;
+    }
+
+    // Bucket for `now`, cleared if it last counted an older slot.
+    Bucket& bucket_at(int64_t now) {
+        int64_t epoch = (now - t0) / bucket_ms();
+        Bucket& b = buckets[(size_t)(epoch % kBuckets + kBuckets) % kBuckets];
+        if (b.epoch != epoch) b = Bucket{epoch, 0, 0, 0};
+        return b;
+    }
+    Bucket totals(int64_t now) const {
+        int64_t epoch = (now - t0) / bucket_ms();
+        Bucket t;
+        for (const Bucket& b : buckets)
+            if (b.epoch > epoch - kBuckets && b.epoch <= epoch) {
+                t.attempts += b.attempts;
+                t.failures += b.failures;
+                t.retries += b.retries;
+            }
+        return t;
+    }
+
+    // Called for every finished attempt; for a failed one that has retries
+    // left (`retryable`), decides whether it gets one.
+    Verdict on_outcome(int64_t now, bool failed, bool retryable) {
+        if (!windowed()) {
+            if (retryable) retried.fetch_add(1, std::memory_order_relaxed);
+            return Verdict::Retry;
+        }
+        std::lock_guard<std::mutex> lk(mu);
+        if (open && now >= open_until) {
+            for (Bucket& x : buckets) x = Bucket{};
+            open = false;
+        }
+        Bucket& b = bucket_at(now);
+        b.attempts++;
+        if (failed) b.failures++;
+        Bucket t = totals(now);
+        if (threshold > 0 && now >= open_until && t.attempts >= kMinSamples
+            && (double)t.failures >= threshold * (double)t.attempts) {
+            open_until = now + open_ms;
+            open = true;
+            for (Bucket& x : buckets) x = Bucket{};
+            breaker_opens.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!retryable) return Verdict::Retry;
+        if (now < open_until) {
+            denied_breaker.fetch_add(1, std::memory_order_relaxed);
+            return Verdict::BreakerOpen;
+        }
+        if (budget > 0 && (double)t.retries >= budget * (double)t.attempts + (double)kMinRetries) {
+            denied_budget.fetch_add(1, std::memory_order_relaxed);
+            return Verdict::NoBudget;
+        }
+        bucket_at(now).retries++;
+        retried.fetch_add(1, std::memory_order_relaxed);
+        return Verdict::Retry;
+    }
+};
+
+// --fail-probs "0.2,0.14,0.08,0.02": failure chance of attempt 0, 1, ...
+std::vector<double> parse_fail_probs(const std::string& s) {
+    std::vector<double> out;
+    if (s.empty()) return out;
+    std::stringstream in(s);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        char* end = nullptr;
+        double p = std::strtod(item.c_str(), &end);
+        if (end == item.c_str() || p < 0 || p > 1) {
+            std::cerr << "--fail-probs: expected comma-separated probabilities in [0,1], got "
+                      << s << "\n";
+            std::exit(1);
+        }
+        out.push_back(p);
+    }
+    if (out.size() > (size_t)RNG::kMaxFailSteps) {
+        std::cerr << "--fail-probs: at most " << RNG::kMaxFailSteps << " values\n";
+        std::exit(1);
+    }
+    return out;
+}
+
+// --fail-spike FROM_MS:TO_MS:P, offsets from the start of the run.
+struct FailSpike {
+    int64_t from_ms = 0, to_ms = 0;
+    double p = 0;
+    bool active() const { return to_ms > from_ms; }
+};
+
+FailSpike parse_fail_spike(const std::string& s) {
+    FailSpike f;
+    if (s.empty()) return f;
+    long long from = 0, to = 0;
+    double p = 0;
+    if (std::sscanf(s.c_str(), "%lld:%lld:%lf", &from, &to, &p) != 3 || to <= from || p < 0 || p > 1) {
+        std::cerr << "--fail-spike: expected FROM_MS:TO_MS:P with FROM_MS < TO_MS, got " << s << "\n";
+        std::exit(1);
+    }
+    f.from_ms = from;
+    f.to_ms = to;
+    f.p = p;
+    return f;
+}
+
+// --------------------------- Logging ---------------------------
+enum class LogLevel { Quiet, Summary, Job };
+
+LogLevel parse_log_level(const std::string& s) {
+    if (s == "quiet") return LogLevel::Quiet;
+    if (s == "summary") return LogLevel::Summary;
+    if (s == "job") return LogLevel::Job;
+    std::cerr << "Unknown --log-level: " << s << "\n";
+    std::exit(1);
+}
+
+// Asynchronous console sink. Each thread appends lines to its own
+// thread_local buffer without locking; full buffers (and a thread's last
+// partial buffer, at exit) are handed to a flusher thread that does the
+// actual stdout writes. Job lines can be rate-limited per wall-clock second.
+struct Logger {
+    static constexpr size_t kBufBytes = 16 * 1024;
+
+    std::mutex mu;                      // guards ready, busy, stopping
+    std::condition_variable cv;         // flusher: work available
+    std::condition_variable idle_cv;    // sync(): flusher caught up
+    std::vector<std::string> ready;
+    bool busy = false;
+    bool stopping = false;
+    std::thread flusher;
+
+    std::atomic<int> rate{0};
+    std::atomic<int64_t> window{0};     // current rate-limit second
+    std::atomic<int> in_window{0};
+    std::atomic<uint64_t> suppressed{0};
+
+    struct ThreadBuf {
+        Logger* owner;
+        std::string buf;
+        explicit ThreadBuf(Logger* l) : owner(l) { buf.reserve(kBufBytes); }
+        ~ThreadBuf() { owner->hand_off(buf); }
+    };
+
+    Logger() {
+        flusher = std::thread([this]{
+            PROF_THREAD("log-flusher");
+            flush_loop();
+        });
+    }
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            stopping = true;
+        }
+        cv.notify_one();
+        flusher.join();
+    }
+
+    std::string& local() {
+        thread_local ThreadBuf tb(this);
+        return tb.buf;
+    }
+
+    // Call after appending a complete line to local().
+    void commit(std::string& buf) {
+        if (buf.size() >= kBufBytes) hand_off(buf);
+    }
+
+    void hand_off(std::string& buf) {
+        if (buf.empty()) return;
+        std::string out;
+        out.reserve(kBufBytes);
+        out.swap(buf);
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            ready.push_back(std::move(out));
+        }
+        cv.notify_one();
+    }
+
+    // True if another job line may be printed in the current second.
+    bool admit_job_line() {
+        int limit = rate.load(std::memory_order_relaxed);
+        if (limit <= 0) return true;
+        int64_t sec = now_ms() / 1000;
+        int64_t w = window.load(std::memory_order_relaxed);
+        if (w != sec && window.compare_exchange_strong(w, sec))
+            in_window.store(0, std::memory_order_relaxed);
+        if (in_window.fetch_add(1, std::memory_order_relaxed) < limit) return true;
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Flushes the calling thread's buffer and waits until everything handed
+    // off so far is on stdout. Other threads' partial buffers arrive when
+    // they exit.
+    void sync() {
+        hand_off(local());
+        std::unique_lock<std::mutex> lk(mu);
+        idle_cv.wait(lk, [&]{ return ready.empty() && !busy; });
+    }
+
+    void flush_loop() {
+        std::vector<std::string> batch;
+        std::unique_lock<std::mutex> lk(mu);
+        for (;;) {
+            cv.wait_for(lk, Ms(100), [&]{ return stopping || !ready.empty(); });
+            if (ready.empty()) {
+                if (stopping) return;
+                continue;
+            }
+            batch.swap(ready);
+            busy = true;
+            lk.unlock();
+            {
+                PROF_SCOPE(Phase::Log);
+                for (auto& b : batch) std::fwrite(b.data(), 1, b.size(), stdout);
+                std::fflush(stdout);
+            }
+            batch.clear();
+            lk.lock();
+            busy = false;
+            idle_cv.notify_all();
+        }
+    }
+};
+
+Logger& logger() {
+    static Logger l;
+    return l;
+}
+
+// --------------------------- Ingestion ---------------------------
+// One job as described by an input trace. Fields left at -1 were absent.
+struct JobSpec {
+    int64_t arrival_ms = 0;     // offset from run start
+    int ext_id = -1;
+    int priority = -1;
+    int service_ms = -1;
+    int deadline_ms = -1;       // relative to arrival
+};
+
+// Produces jobs in arrival order, one at a time, so a trace never has to be
+// held in memory. next() returns false once the source is exhausted.
+struct JobSource {
+    virtual ~JobSource() = default;
+    virtual bool next(JobSpec& out) = 0;
+};
+
+// Finds `"key": <integer>` in a flat JSON object. Returns false if absent or
+// not a number.
+bool json_int(const std::string& line, const char* key, int64_t& out) {
+    std::string pat = std::string("\"") + key + "\"";
+    size_t p = line.find(pat);
+    if (p == std::string::npos) return false;
+    p = line.find_first_not_of(" \t", p + pat.size());
+    if (p == std::string::npos || line[p] != ':') return false;
+    p = line.find_first_not_of(" \t", p + 1);
+    if (p == std::string::npos) return false;
+    const char* begin = line.c_str() + p;
+    char* endp = nullptr;
+    long long v = std::strtoll(begin, &endp, 10);
+    if (endp == begin) return false;
+    out = v;
+    return true;
+}
+
+// Streams job specs from a JSON-lines trace, one object per line:
+//   {"ext_id": 7, "priority": 3, "service_ms": 250, "arrival_ms": 1200}
+// Every field is optional (as is "deadline_ms", relative to arrival).
+// Malformed lines are reported and skipped.
+struct JsonlSource : JobSource {
+    std::ifstream file;
+    std::istream* in = nullptr;
+    std::string path;
+    std::string line;
+    int64_t line_no = 0;
+    int64_t last_arrival = 0;
+    int next_id = 1;
+
+    explicit JsonlSource(const std::string& p) : path(p) {
+        if (p == "-") { in = &std::cin; return; }
+        file.open(p);
+        if (!file) {
+            std::cerr << "Failed to open input: " << p << "\n";
+            std::exit(1);
+        }
+        in = &file;
+    }
+
+    bool next(JobSpec& out) override {
+        while (std::getline(*in, line)) {
+            ++line_no;
+            size_t b = line.find_first_not_of(" \t\r");
+            if (b == std::string::npos) continue;
+            if (line[b] != '{') {
+                std::cerr << path << ":" << line_no << ": skipping non-object line\n";
+                continue;
+            }
+            out = JobSpec{};
+            int64_t v;
+            if (json_int(line, "arrival_ms", v)) out.arrival_ms = v;
+            if (json_int(line, "ext_id", v)) out.ext_id = (int)v;
+            if (json_int(line, "priority", v)) out.priority = (int)v;
+            if (json_int(line, "service_ms", v)) out.service_ms = (int)v;
+            if (json_int(line, "deadline_ms", v)) out.deadline_ms = (int)v;
+            if (out.ext_id < 0) out.ext_id = next_id;
+            next_id = std::max(next_id, out.ext_id + 1);
+            // Arrivals must not go back in time; late lines arrive immediately.
+            out.arrival_ms = std::max(last_arrival, out.arrival_ms);
+            last_arrival = out.arrival_ms;
+            return true;
+        }
+        return false;
+    }
+};
+
+// Closed batch of `count` jobs that all arrive at the start. Stands in for
+// seeding the scheduler up front when --max-queue must see each admission.
+struct BatchSource : JobSource {
+    int count;
+    int issued = 0;
+    explicit BatchSource(int n) : count(n) {}
+    bool next(JobSpec& out) override {
+        if (issued >= count) return false;
+        out = JobSpec{};
+        out.ext_id = ++issued;
+        return true;
+    }
+};
+
+// A resumed run's journaled jobs, replayed through admission when
+// --max-queue bounds the queue so the backlog enters as room frees up.
+// next() only names the job; Dispatcher::admit() takes it from last().
+struct JournalSource : JobSource {
+    std::vector<Job> jobs;
+    size_t pos = 0;
+    bool next(JobSpec& out) override {
+        if (pos >= jobs.size()) return false;
+        out = JobSpec{};
+        out.ext_id = jobs[pos++].ext_id;
+        return true;
+    }
+    const Job& last() const { return jobs[pos - 1]; }
+};
+
+// Open-loop arrival process: `count` synthetic jobs arriving at
+// `rate` jobs/s on average, independent of how fast they are served.
+//   poisson  - exponential inter-arrival gaps
+//   constant - evenly spaced
+//   bursty   - Poisson during on-periods, silent during off-periods; the
+//              on-period rate is scaled so the long-run mean is still `rate`
+struct ArrivalSource : JobSource {
+    enum Dist { Poisson, Constant, Bursty };
+    Dist dist;
+    int remaining;
+    int issued = 0;
+    double mean_gap_ms;
+    double on_ms, off_ms;
+    double t = 0;           // offset of the previous arrival, ms
+    Xoshiro256 gen;
+    std::exponential_distribution<double> gap;
+
+    ArrivalSource(int count, double rate, const std::string& d, int on, int off,
+                  uint64_t seed)
+      : remaining(count), on_ms(std::max(1, on)), off_ms(std::max(0, off)), gen(seed) {
+        if (d == "poisson") dist = Poisson;
+        else if (d == "constant") dist = Constant;
+        else if (d == "bursty") dist = Bursty;
+        else {
+            std::cerr << "Unknown --arrival-dist: " << d << "\n";
+            std::exit(1);
+        }
+        mean_gap_ms = 1000.0 / rate;
+        if (dist == Bursty) mean_gap_ms *= on_ms / (on_ms + off_ms);
+        gap = std::exponential_distribution<double>(1.0 / mean_gap_ms);
+    }
+
+    bool next(JobSpec& out) override {
+        if (remaining <= 0) return false;
+        --remaining;
+        if (dist == Constant) {
+            t += mean_gap_ms;
+        } else {
+            t += gap(gen);
+            if (dist == Bursty) {
+                // Skip over any off-period the gap landed in.
+                double cycle = on_ms + off_ms;
+                double phase = std::fmod(t, cycle);
+                if (phase >= on_ms) t += cycle - phase;
+            }
+        }
+        out = JobSpec{};
+        out.ext_id = ++issued;
+        out.arrival_ms = (int64_t)t;
+        return true;
+    }
+};
+
+// --------------------------- Metrics ---------------------------
+inline int msb_index(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#else
+    int m = 0;
+    while (v >>= 1) ++m;
+    return m;
+#endif
+}
+
+// Fixed-memory latency histogram with HDR-style log buckets: values below
+// 2*kSub are exact, larger ones fall into kSub linear sub-buckets per power
+// of two (~3% relative error). Memory does not depend on the sample count.
+struct LatencyHistogram {
+    static constexpr int kSubBits = 5;
+    static constexpr int64_t kSub = int64_t(1) << kSubBits;
+    static constexpr int kBuckets = (31 - kSubBits) * (int)kSub + 2 * (int)kSub;
+
+    uint64_t counts[kBuckets] = {};
+    uint64_t total = 0;
+    int64_t max_v = 0;
+
+    static int index_of(int64_t v) {
+        if (v < 2 * kSub) return (int)v;
+        int shift = msb_index((uint64_t)v) - kSubBits;
+        return shift * (int)kSub + (int)(v >> shift);
+    }
+    // Largest value that maps to bucket i.
+    static int64_t upper_of(int i) {
+        if (i < 2 * kSub) return i;
+        int shift = i / (int)kSub - 1;
+        int64_t sub = i - shift * kSub;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    void record(int64_t v) {
+        v = std::min<int64_t>(std::max<int64_t>(0, v), INT32_MAX);
+        counts[index_of(v)]++;
+        total++;
+        max_v = std::max(max_v, v);
+    }
+
+    void merge(const LatencyHistogram& o) {
+        for (int i = 0; i < kBuckets; ++i) counts[i] += o.counts[i];
+        total += o.total;
+        max_v = std::max(max_v, o.max_v);
+    }
+
+    // q in [0,1]; returns the upper edge of the bucket holding that rank.
+    double percentile(double q) const {
+        if (total == 0) return 0.0;
+        uint64_t rank = (uint64_t)std::ceil(q * (double)total);
+        rank = std::max<uint64_t>(1, std::min(rank, total));
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return (double)std::min(upper_of(i), max_v);
+        }
+        return (double)max_v;
+    }
+};
+
+struct Percentiles {
+    double p50 = 0, p90 = 0, p99 = 0, p999 = 0;
+
+    static Percentiles of(const LatencyHistogram& h) {
+        return Percentiles{h.percentile(0.50), h.percentile(0.90),
+                           h.percentile(0.99), h.percentile(0.999)};
+    }
+};
+
+// Run-time view for --metrics-port. Dispatch threads only do relaxed atomic
+// adds here and the HTTP thread only loads, so a scrape never takes a lock
+// on the dispatch path. Buckets are coarse Prometheus-style upper bounds.
+struct LiveHistogram {
+    static constexpr int kBounds = 12;
+    static constexpr int64_t kLe[kBounds] = {5, 10, 25, 50, 100, 250, 500,
+                                             1000, 2500, 5000, 10000, 60000};
+
+    std::atomic<uint64_t> buckets[kBounds + 1] = {};  // last one is +Inf
+    std::atomic<int64_t> sum{0};
+
+    void observe(int64_t ms) {
+        int b = 0;
+        while (b < kBounds && ms > kLe[b]) ++b;
+        buckets[b].fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(ms, std::memory_order_relaxed);
+    }
+
+    void render(std::string& out, const char* name, const char* help) const {
+        char line[160];
+        std::snprintf(line, sizeof line, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+        out += line;
+        uint64_t cum = 0;
+        for (int b = 0; b <= kBounds; ++b) {
+            cum += buckets[b].load(std::memory_order_relaxed);
+            if (b < kBounds)
+                std::snprintf(line, sizeof line, "%s_bucket{le=\"%lld\"} %llu\n", name,
+                              (long long)kLe[b], (unsigned long long)cum);
+            else
+                std::snprintf(line, sizeof line, "%s_bucket{le=\"+Inf\"} %llu\n", name,
+                              (unsigned long long)cum);
+            out += line;
+        }
+        std::snprintf(line, sizeof line, "%s_sum %lld\n%s_count %llu\n",
+                      name, (long long)sum.load(std::memory_order_relaxed),
+                      name, (unsigned long long)cum);
+        out += line;
+    }
+};
+
+struct LiveMetrics {
+    std::atomic<int64_t> in_flight{0};
+    std::atomic<uint64_t> attempts{0};
+    std::atomic<uint64_t> successes{0};
+    std::atomic<uint64_t> failures{0};      // terminal, retries exhausted
+    std::atomic<uint64_t> retries{0};
+    std::atomic<uint64_t> rejected{0};
+    std::atomic<uint64_t> dropped{0};
+    LiveHistogram wait, turnaround;
+
+    void add(std::atomic<uint64_t>& c) { c.fetch_add(1, std::memory_order_relaxed); }
+};
+
+// Totals written to the runs row once a run is over.
+struct RunSummary {
+    int total = 0;
+    int successes = 0;
+    int failures = 0;
+    double avg_wait = 0;
+    double avg_service = 0;
+    double avg_turn = 0;
+    double throughput = 0;
+    Percentiles wait, service, turn;
+    Percentiles job;            // successful jobs, first enqueue to success
+    std::string policy;
+    int deadline_misses = 0;
+    uint64_t seed = 0;
+    std::string executor;
+    int max_inflight = 0;       // 0 = one attempt per worker thread
+    int64_t peak_inflight = 0;
+    double utilization = 0;     // busy time over run time x slots
+    std::string sink;           // where the job rows went (--sink)
+    int64_t rejected = 0;       // turned away at admission (--overload reject)
+    int64_t dropped = 0;        // shed from a full queue (--overload shed)
+    int64_t denied_retries = 0; // failed terminally by retry budget or breaker
+    double first_dispatch_ms = -1; // wall time from startup to the first attempt; -1 = none
+};
+
+// --------------------------- SQLite helpers ---------------------------
+struct DB {
+    // Stored in PRAGMA user_version once create_schema() has run, so a
+    // database already at this version opens without re-checking every
+    // table and column. Bump it with every schema change.
+    static constexpr int kSchemaVersion = 1;
+
+    sqlite3* db = nullptr;
+    explicit DB(const std::string& path) {
+        if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+            std::cerr << "Failed to open DB: " << sqlite3_errmsg(db) << "\n";
+            std::exit(1);
+        }
+        exec("PRAGMA synchronous=NORMAL;");     // per connection
+        if (user_version() != kSchemaVersion) {
+            exec("PRAGMA journal_mode=WAL;");   // persists in the file
+            create_schema();
+            exec("PRAGMA user_version=" + std::to_string(kSchemaVersion) + ";");
+        }
+    }
+    ~DB(){ if (db) sqlite3_close(db); }
+
+    void exec(const std::string& sql) {
+        char* err = nullptr;
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+            std::string m = err ? err : "unknown";
+            sqlite3_free(err);
+            std::cerr << "SQL error: " << m << "\n";
+            std::exit(1);
+        }
+    }
+
+    void create_schema() {
+        exec(R"SQL(
+        CREATE TABLE IF NOT EXISTS runs(
+          run_id INTEGER PRIMARY KEY AUTOINCREMENT,
+          started_at INTEGER,
+          finished_at INTEGER,
+          total_jobs INTEGER,
+          success_jobs INTEGER,
+          failed_jobs INTEGER,
+          avg_wait_ms REAL,
+          avg_service_ms REAL,
+          avg_turnaround_ms REAL,
+          throughput_jobs_per_s REAL
+        );
+        CREATE TABLE IF NOT EXISTS jobs(
+          job_id INTEGER PRIMARY KEY AUTOINCREMENT,
+          run_id INTEGER,
+          ext_id INTEGER,
+          priority INTEGER,
+          attempt INTEGER,
+          status TEXT,
+          fail_reason TEXT,
+          enqueue_ts INTEGER,
+          start_ts INTEGER,
+          end_ts INTEGER,
+          wait_ms INTEGER,
+          service_ms INTEGER,
+          turnaround_ms INTEGER
+        );
+        CREATE INDEX IF NOT EXISTS idx_jobs_run_status ON jobs(run_id, status);
+        CREATE TABLE IF NOT EXISTS queue(
+          run_id INTEGER,
+          ext_id INTEGER,
+          priority INTEGER,
+          attempt INTEGER,
+          max_retries INTEGER,
+          enqueue_ts INTEGER,
+          deadline_ts INTEGER,
+          spec_service_ms INTEGER,
+          mlfq_level INTEGER,
+          PRIMARY KEY(run_id, ext_id)
+        );
+        CREATE TABLE IF NOT EXISTS sweep_results(
+          sweep_id INTEGER,
+          scenario INTEGER,
+          params TEXT,
+          jobs INTEGER,
+          mean_ms INTEGER,
+          stddev_ms INTEGER,
+          max_retries INTEGER,
+          workers INTEGER,
+          policy TEXT,
+          seed INTEGER,
+          total_jobs INTEGER,
+          success_jobs INTEGER,
+          failed_jobs INTEGER,
+          avg_wait_ms REAL,
+          avg_turnaround_ms REAL,
+          throughput_jobs_per_s REAL,
+          utilization REAL,
+          wait_p99_ms REAL,
+          turnaround_p99_ms REAL,
+          deadline_misses INTEGER,
+          wall_ms REAL,
+          PRIMARY KEY(sweep_id, scenario)
+        );
+        )SQL");
+
+        // Columns added after the original schema; older databases get them
+        // on open.
+        for (const char* metric : {"wait", "service", "turnaround"})
+            for (const char* pct : {"p50", "p90", "p99", "p999"})
+                ensure_column("runs", std::string(metric) + "_" + pct + "_ms", "REAL");
+        ensure_column("runs", "policy", "TEXT");
+        ensure_column("runs", "deadline_misses", "INTEGER");
+        ensure_column("runs", "seed", "INTEGER");
+        ensure_column("runs", "executor", "TEXT");
+        ensure_column("runs", "max_inflight", "INTEGER");
+        ensure_column("runs", "sink", "TEXT");
+        ensure_column("runs", "rejected_jobs", "INTEGER");
+        ensure_column("runs", "dropped_jobs", "INTEGER");
+        ensure_column("runs", "first_dispatch_ms", "REAL");
+        ensure_column("sweep_results", "rejected_jobs", "INTEGER");
+        ensure_column("sweep_results", "dropped_jobs", "INTEGER");
+        ensure_column("sweep_results", "job_p99_ms", "REAL");
+        ensure_column("sweep_results", "denied_retries", "INTEGER");
+    }
+
+    int user_version() {
+        sqlite3_stmt* st = nullptr;
+        if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &st, nullptr) != SQLITE_OK) {
+            std::cerr << "SQL error: " << sqlite3_errmsg(db) << "\n";
+            std::exit(1);
+        }
+        int v = sqlite3_step(st) == SQLITE_ROW ? sqlite3_column_int(st, 0) : 0;
+        sqlite3_finalize(st);
+        return v;
+    }
+
+    bool has_column(const std::string& table, const std::string& column) {
+        sqlite3_stmt* st = nullptr;
+        std::string sql = "PRAGMA table_info(" + table + ");";
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &st, nullptr) != SQLITE_OK) {
+            std::cerr << "SQL error: " << sqlite3_errmsg(db) << "\n";
+            std::exit(1);
+        }
+        bool found = false;
+        while (!found && sqlite3_step(st) == SQLITE_ROW) {
+            const unsigned char* name = sqlite3_column_text(st, 1);
+            found = name && column == (const char*)name;
+        }
+        sqlite3_finalize(st);
+        return found;
+    }
+
+    void ensure_column(const std::string& table, const std::string& column,
+                       const std::string& type) {
+        if (!has_column(table, column))
+            exec("ALTER TABLE " + table + " ADD COLUMN " + column + " " + type + ";");
+    }
+};
+
+// --------------------------- Record sinks ---------------------------
+// Destination of job rows. RunRecorder's writer thread is the only caller:
+// open() once the run_id is known, write() per row, flush() when rows must
+// reach the OS (before a journal COMMIT), close() at the end of the run.
+// The runs row and the queue journal always stay in SQLite.
+struct RecordSink {
+    virtual ~RecordSink() = default;
+    virtual const char* name() const = 0;
+    virtual bool in_db() const { return false; }  // writes inside the recorder's transaction
+    virtual void open(int run_id) { (void)run_id; }
+    virtual void write(int run_id, const Job& j) = 0;
+    virtual void flush() {}
+    virtual void close() {}
+};
+
+// sqlite: one row per attempt in the jobs table (the original behaviour).
+struct SqliteSink : RecordSink {
+    DB& db;
+    sqlite3_stmt* ins_job = nullptr;
+
+    explicit SqliteSink(DB& d) : db(d) {
+        const char* job_sql =
+          "INSERT INTO jobs(run_id,ext_id,priority,attempt,status,fail_reason,"
+          "enqueue_ts,start_ts,end_ts,wait_ms,service_ms,turnaround_ms)"
+          " VALUES(?,?,?,?,?,?,?,?,?,?,?,?);";
+        if (sqlite3_prepare_v2(db.db, job_sql, -1, &ins_job, nullptr) != SQLITE_OK)
+            die("prepare ins_job");
+    }
+    ~SqliteSink() override { if (ins_job) sqlite3_finalize(ins_job); }
+    [[noreturn]] void die(const char* where) {
+        std::cerr << where << " : " << sqlite3_errmsg(db.db) << "\n";
+        std::exit(1);
+    }
+
+    const char* name() const override { return "sqlite"; }
+    bool in_db() const override { return true; }
+
+    void write(int run_id, const Job& j) override {
+        auto bind_text = [&](int idx, const char* s){
+            if (sqlite3_bind_text(ins_job, idx, s, -1, SQLITE_TRANSIENT) != SQLITE_OK) die("bind_text");
+        };
+        auto bind_int = [&](int idx, int v){
+            if (sqlite3_bind_int(ins_job, idx, v) != SQLITE_OK) die("bind_int");
+        };
+        auto bind_i64 = [&](int idx, int64_t v){
+            if (sqlite3_bind_int64(ins_job, idx, (sqlite3_int64)v) != SQLITE_OK) die("bind_i64");
+        };
+
+        bind_int(1, run_id);
+        bind_int(2, j.ext_id);
+        bind_int(3, j.priority);
+        bind_int(4, j.attempt);
+        bind_text(5, status_str(j.status));
+        bind_text(6, reasons().name(j.fail_reason).c_str());
+        bind_i64(7, j.enqueue_ts);
+        bind_i64(8, std::max<int64_t>(0, j.start_ts));
+        bind_i64(9, std::max<int64_t>(0, j.end_ts));
+        bind_int(10, j.wait_ms);
+        bind_int(11, j.service_ms);
+        bind_int(12, j.turnaround_ms);
+
+        if (sqlite3_step(ins_job) != SQLITE_DONE) die("step ins_job");
+        sqlite3_reset(ins_job);
+        sqlite3_clear_bindings(ins_job);
+    }
+};
+
+// Append-only output file with its own large buffer, so rows reach the OS
+// in kFlushBytes writes rather than one small write each.
+struct SinkFile {
+    static constexpr size_t kFlushBytes = 1 << 20;
+
+    std::string path;
+    std::FILE* f = nullptr;
+    std::string buf;
+    bool fresh = false;         // file was empty when opened
+
+    void open(const std::string& p) {
+        path = p;
+        f = std::fopen(p.c_str(), "ab");
+        if (!f) {
+            std::cerr << "Failed to open sink file: " << p << "\n";
+            std::exit(1);
+        }
+        std::setvbuf(f, nullptr, _IONBF, 0);  // buf already batches writes
+        std::fseek(f, 0, SEEK_END);
+        fresh = std::ftell(f) == 0;
+        buf.reserve(kFlushBytes + 4096);
+    }
+    void maybe_flush() { if (buf.size() >= kFlushBytes) flush(); }
+    void write_raw(const void* p, size_t n) {
+        if (n && std::fwrite(p, 1, n, f) != n) {
+            std::cerr << "Failed to write sink file: " << path << "\n";
+            std::exit(1);
+        }
+    }
+    void flush() {
+        if (!f || buf.empty()) return;
+        write_raw(buf.data(), buf.size());
+        buf.clear();
+    }
+    void close() {
+        flush();
+        if (f) std::fclose(f);
+        f = nullptr;
+    }
+    ~SinkFile() { close(); }
+};
+
+// csv: the jobs table's columns, header written when the file is new.
+struct CsvSink : RecordSink {
+    SinkFile file;
+    explicit CsvSink(const std::string& path) { file.open(path); }
+
+    const char* name() const override { return "csv"; }
+
+    void open(int) override {
+        if (file.fresh)
+            file.buf += "run_id,ext_id,priority,attempt,status,fail_reason,enqueue_ts,"
+                        "start_ts,end_ts,wait_ms,service_ms,turnaround_ms\n";
+        file.fresh = false;
+    }
+
+    void num(int64_t v, char sep = ',') {
+        char tmp[24];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+        file.buf.append(tmp, res.ptr);
+        file.buf += sep;
+    }
+
+    // Task errors become reason names verbatim, so they may need quoting.
+    void text(const std::string& s) {
+        if (s.find_first_of(",\"\r\n") == std::string::npos) {
+            file.buf += s;
+        } else {
+            file.buf += '"';
+            for (char c : s) {
+                if (c == '"') file.buf += '"';
+                file.buf += c;
+            }
+            file.buf += '"';
+        }
+        file.buf += ',';
+    }
+
+    void write(int run_id, const Job& j) override {
+        num(run_id);
+        num(j.ext_id);
+        num(j.priority);
+        num(j.attempt);
+        file.buf += status_str(j.status);
+        file.buf += ',';
+        text(reasons().name(j.fail_reason));
+        num(j.enqueue_ts);
+        num(std::max<int64_t>(0, j.start_ts));
+        num(std::max<int64_t>(0, j.end_ts));
+        num(j.wait_ms);
+        num(j.service_ms);
+        num(j.turnaround_ms, '\n');
+        file.maybe_flush();
+    }
+    void flush() override { file.flush(); }
+    void close() override { file.close(); }
+};
+
+// columnar: fixed-width little-endian columns in row groups of up to
+// kGroupRows. Each run appends one segment:
+//   "DJOBCOL1"  u32 version  i32 run_id
+//   u8 n, n x (u8 len, bytes)                status dictionary, code = JobStatus
+//   group*:  "ROWS" u32 rows, then the columns in order
+//            ext_id i32, priority i16, attempt u8, status u8, fail_reason u16,
+//            enqueue_ts i64, start_ts i64, end_ts i64,
+//            wait_ms i32, service_ms i32, turnaround_ms i32
+//   "DICT" u32 n, n x (u16 len, bytes)       fail_reason dictionary, code = index
+//   "END "
+// 46 bytes a row instead of twelve SQLite values.
+struct ColumnarSink : RecordSink {
+    static constexpr size_t kGroupRows = 65536;
+    static constexpr uint32_t kVersion = 1;
+
+    SinkFile file;
+    std::vector<int32_t> ext_id, wait_ms, service_ms, turnaround_ms;
+    std::vector<int16_t> priority;
+    std::vector<uint8_t> attempt, status;
+    std::vector<uint16_t> fail_reason;
+    std::vector<int64_t> enqueue_ts, start_ts, end_ts;
+    bool segment_open = false;
+
+    explicit ColumnarSink(const std::string& path) { file.open(path); }
+
+    const char* name() const override { return "columnar"; }
+
+    static bool little_endian() {
+        const uint16_t probe = 1;
+        return *(const uint8_t*)&probe == 1;
+    }
+
+    template <class T>
+    void put(const T* v, size_t n) {
+        static_assert(std::is_integral<T>::value, "fixed-width columns only");
+        if (little_endian()) {
+            file.buf.append((const char*)v, n * sizeof(T));
+            return;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            typename std::make_unsigned<T>::type u = (typename std::make_unsigned<T>::type)v[i];
+            for (size_t b = 0; b < sizeof(T); ++b) file.buf += (char)(u >> (8 * b));
+        }
+    }
+    template <class T>
+    void put(T v) { put(&v, 1); }
+    void put_tag(const char* tag) { file.buf.append(tag, 4); }
+
+    void open(int run_id) override {
+        file.buf.append("DJOBCOL1", 8);
+        put<uint32_t>(kVersion);
+        put<int32_t>(run_id);
+        const JobStatus all[] = {JobStatus::Pending, JobStatus::Running,
+                                 JobStatus::Success, JobStatus::Failed,
+                                 JobStatus::Rejected, JobStatus::Dropped};
+        put<uint8_t>((uint8_t)(sizeof(all) / sizeof(all[0])));
+        for (JobStatus s : all) {
+            const char* n = status_str(s);
+            put<uint8_t>((uint8_t)std::strlen(n));
+            file.buf += n;
+        }
+        segment_open = true;
+        reserve();
+    }
+
+    void reserve() {
+        for (auto* c : {&ext_id, &wait_ms, &service_ms, &turnaround_ms}) c->reserve(kGroupRows);
+        priority.reserve(kGroupRows);
+        attempt.reserve(kGroupRows);
+        status.reserve(kGroupRows);
+        fail_reason.reserve(kGroupRows);
+        for (auto* c : {&enqueue_ts, &start_ts, &end_ts}) c->reserve(kGroupRows);
+    }
+
+    void write(int, const Job& j) override {
+        ext_id.push_back(j.ext_id);
+        priority.push_back(j.priority);
+        attempt.push_back(j.attempt);
+        status.push_back((uint8_t)j.status);
+        fail_reason.push_back(j.fail_reason);
+        enqueue_ts.push_back(j.enqueue_ts);
+        start_ts.push_back(std::max<int64_t>(0, j.start_ts));
+        end_ts.push_back(std::max<int64_t>(0, j.end_ts));
+        wait_ms.push_back(j.wait_ms);
+        service_ms.push_back(j.service_ms);
+        turnaround_ms.push_back(j.turnaround_ms);
+        if (ext_id.size() >= kGroupRows) write_group();
+    }
+
+    // Columns go straight from their vectors to the file, one large write
+    // each, on little-endian hosts.
+    template <class T>
+    void put_column(std::vector<T>& c) {
+        if (little_endian()) {
+            file.flush();
+            file.write_raw(c.data(), c.size() * sizeof(T));
+        } else {
+            put(c.data(), c.size());
+            file.maybe_flush();
+        }
+        c.clear();
+    }
+
+    void write_group() {
+        if (ext_id.empty()) return;
+        put_tag("ROWS");
+        put<uint32_t>((uint32_t)ext_id.size());
+        put_column(ext_id);
+        put_column(priority);
+        put_column(attempt);
+        put_column(status);
+        put_column(fail_reason);
+        put_column(enqueue_ts);
+        put_column(start_ts);
+        put_column(end_ts);
+        put_column(wait_ms);
+        put_column(service_ms);
+        put_column(turnaround_ms);
+    }
+
+    // Only called with journaling on, before the COMMIT that marks these
+    // rows' jobs done, so the rows still in the column vectors go out now
+    // as a short group rather than waiting for a full one.
+    void flush() override {
+        write_group();
+        file.flush();
+    }
+
+    void close() override {
+        if (!segment_open) return;
+        write_group();
+        put_tag("DICT");
+        size_t n = reasons().size();
+        put<uint32_t>((uint32_t)n);
+        for (size_t id = 0; id < n; ++id) {
+            const std::string& name = reasons().name((uint16_t)id);
+            put<uint16_t>((uint16_t)name.size());
+            file.buf += name;
+        }
+        put_tag("END ");
+        segment_open = false;
+        file.close();
+    }
+};
+
+// --sink sqlite | csv[:path] | columnar[:path]. File sinks default to the
+// database path with .jobs.csv / .jobs.col in place of its extension.
+std::unique_ptr<RecordSink> make_sink(const std::string& spec, DB& db, const std::string& db_path) {
+    size_t colon = spec.find(':');
+    std::string kind = spec.substr(0, colon);
+    std::string path = colon == std::string::npos ? std::string() : spec.substr(colon + 1);
+    auto default_path = [&](const char* ext){
+        size_t dot = db_path.find_last_of('.');
+        size_t slash = db_path.find_last_of("/\\");
+        std::string stem = dot != std::string::npos && (slash == std::string::npos || dot > slash)
+                         ? db_path.substr(0, dot) : db_path;
+        return stem + ext;
+    };
+    if (kind == "sqlite" && path.empty()) return std::unique_ptr<RecordSink>(new SqliteSink(db));
+    if (kind == "csv")
+        return std::unique_ptr<RecordSink>(new CsvSink(path.empty() ? default_path(".jobs.csv") : path));
+    if (kind == "columnar")
+        return std::unique_ptr<RecordSink>(
+            new ColumnarSink(path.empty() ? default_path(".jobs.col") : path));
+    std::cerr << "Unknown --sink: " << spec << " (expected sqlite, csv[:path] or columnar[:path])\n";
+    std::exit(1);
+}
+
+// Job rows are written off the dispatch path: record_job() only appends to an
+// in-memory queue and a writer thread drains it in batches of `batch_size`,
+// each inside one explicit transaction. end() flushes whatever is left.
+// The runs row is inserted by begin() so every job row carries its run_id;
+// record_run_summary() fills in the totals once the run is over.
+//
+// With journaling on, the same queue also carries upserts and deletes for
+// the queue table: a job is journaled when it is queued (and again when a
+// retry changes its attempt) and deleted once terminal, so the table holds
+// exactly the unfinished jobs of a run. They share the batch transactions,
+// which gives group commit for free. Each transaction also adds its
+// terminal jobs to the runs row's totals, so those stay exact across a
+// crash and any number of --resume runs.
+struct RunRecorder {
+    struct Record {
+        enum Kind : uint8_t { JobRow, QueuePut, QueueDel };
+        Kind kind;
+        Job job;
+    };
+
+    DB& db;
+    std::unique_ptr<RecordSink> sink;
+    sqlite3_stmt* ins_run = nullptr;
+    sqlite3_stmt* upd_run = nullptr;
+    sqlite3_stmt* put_queue = nullptr;
+    sqlite3_stmt* del_queue = nullptr;
+    sqlite3_stmt* add_totals = nullptr;
+    bool journal = false;
+    bool job_rows = true;           // false: record_job() is a no-op
+    int64_t run_start_ms = 0;
+    int64_t run_end_ms = 0;
+    int run_id = 0;
+
+    size_t batch_size;
+    std::mutex q_mu;                // guards pending and stopping
+    std::condition_variable q_cv;
+    std::condition_variable room_cv;  // writer drained pending
+    std::vector<Record> pending;
+    bool stopping = false;
+    std::thread writer;
+
+    // Job rows go to `s`, or to the jobs table if it is null.
+    explicit RunRecorder(DB& d, int batch = 1000, std::unique_ptr<RecordSink> s = nullptr)
+      : db(d), sink(s ? std::move(s) : std::unique_ptr<RecordSink>(new SqliteSink(d))),
+        batch_size((size_t)std::max(1, batch)) {
+        prepare();
+    }
+    ~RunRecorder() {
+        stop_writer();
+        sink->close();
+        if (ins_run) sqlite3_finalize(ins_run);
+        if (upd_run) sqlite3_finalize(upd_run);
+        if (put_queue) sqlite3_finalize(put_queue);
+        if (del_queue) sqlite3_finalize(del_queue);
+        if (add_totals) sqlite3_finalize(add_totals);
+    }
+    void prepare() {
+        const char* run_sql = "INSERT INTO runs(started_at,seed) VALUES(?,?);";
+        if (sqlite3_prepare_v2(db.db, run_sql, -1, &ins_run, nullptr) != SQLITE_OK)
+            die("prepare ins_run");
+
+        const char* upd_sql =
+          "UPDATE runs SET finished_at=?,total_jobs=?,success_jobs=?,failed_jobs=?,"
+          "avg_wait_ms=?,avg_service_ms=?,avg_turnaround_ms=?,throughput_jobs_per_s=?,"
+          "wait_p50_ms=?,wait_p90_ms=?,wait_p99_ms=?,wait_p999_ms=?,"
+          "service_p50_ms=?,service_p90_ms=?,service_p99_ms=?,service_p999_ms=?,"
+          "turnaround_p50_ms=?,turnaround_p90_ms=?,turnaround_p99_ms=?,turnaround_p999_ms=?,"
+          "policy=?,deadline_misses=?,seed=?,executor=?,max_inflight=?,sink=?,"
+          "rejected_jobs=?,dropped_jobs=?,first_dispatch_ms=?"
+          " WHERE run_id=?;";
+        if (sqlite3_prepare_v2(db.db, upd_sql, -1, &upd_run, nullptr) != SQLITE_OK)
+            die("prepare upd_run");
+
+        const char* put_sql =
+          "INSERT OR REPLACE INTO queue(run_id,ext_id,priority,attempt,max_retries,"
+          "enqueue_ts,deadline_ts,spec_service_ms,mlfq_level)"
+          " VALUES(?,?,?,?,?,?,?,?,?);";
+        if (sqlite3_prepare_v2(db.db, put_sql, -1, &put_queue, nullptr) != SQLITE_OK)
+            die("prepare put_queue");
+
+        const char* del_sql = "DELETE FROM queue WHERE run_id=? AND ext_id=?;";
+        if (sqlite3_prepare_v2(db.db, del_sql, -1, &del_queue, nullptr) != SQLITE_OK)
+            die("prepare del_queue");
+
+        const char* totals_sql =
+          "UPDATE runs SET total_jobs=COALESCE(total_jobs,0)+?,"
+          "success_jobs=COALESCE(success_jobs,0)+?,failed_jobs=COALESCE(failed_jobs,0)+?"
+          " WHERE run_id=?;";
+        if (sqlite3_prepare_v2(db.db, totals_sql, -1, &add_totals, nullptr) != SQLITE_OK)
+            die("prepare add_totals");
+    }
+    [[noreturn]] void die(const char* where) {
+        std::cerr << where << " : " << sqlite3_errmsg(db.db) << "\n";
+        std::exit(1);
+    }
+
+    // The seed goes in up front so --resume can reuse it after a crash.
+    void begin(int64_t start_ms, uint64_t seed) {
+        run_start_ms = start_ms;
+        if (sqlite3_bind_int64(ins_run, 1, (sqlite3_int64)run_start_ms) != SQLITE_OK) die("bind i64 run");
+        if (sqlite3_bind_int64(ins_run, 2, (sqlite3_int64)seed) != SQLITE_OK) die("bind i64 run");
+        if (sqlite3_step(ins_run) != SQLITE_DONE) die("step ins_run");
+        run_id = (int)sqlite3_last_insert_rowid(db.db);
+        sqlite3_reset(ins_run);
+        sqlite3_clear_bindings(ins_run);
+        sink->open(run_id);
+        start_writer();
+    }
+
+    // Continues an existing run instead of inserting a new runs row.
+    void resume(int id, int64_t start_ms) {
+        run_id = id;
+        run_start_ms = start_ms;
+        sink->open(run_id);
+        start_writer();
+    }
+
+    void start_writer() {
+        stopping = false;
+        writer = std::thread([this]{
+            PROF_THREAD("db-writer");
+            writer_loop();
+        });
+    }
+
+    // What the runs row of `id` holds so far; NULLs (a run that never
+    // finished) read as 0. Returns false if there is no such run.
+    struct RunTotals {
+        int64_t total = 0, successes = 0, failures = 0;
+        uint64_t seed = 0;
+        int64_t queued = 0;         // rows left in the queue journal
+    };
+    bool load_run(int id, RunTotals& out) {
+        sqlite3_stmt* st = nullptr;
+        const char* sql =
+          "SELECT COALESCE(total_jobs,0),COALESCE(success_jobs,0),COALESCE(failed_jobs,0),"
+          "COALESCE(seed,0),(SELECT COUNT(*) FROM queue WHERE run_id=runs.run_id)"
+          " FROM runs WHERE run_id=?;";
+        if (sqlite3_prepare_v2(db.db, sql, -1, &st, nullptr) != SQLITE_OK) die("prepare load_run");
+        if (sqlite3_bind_int(st, 1, id) != SQLITE_OK) die("bind load_run");
+        bool found = sqlite3_step(st) == SQLITE_ROW;
+        if (found) {
+            out.total = sqlite3_column_int64(st, 0);
+            out.successes = sqlite3_column_int64(st, 1);
+            out.failures = sqlite3_column_int64(st, 2);
+            out.seed = (uint64_t)sqlite3_column_int64(st, 3);
+            out.queued = sqlite3_column_int64(st, 4);
+        }
+        sqlite3_finalize(st);
+        return found;
+    }
+
+    // Streams the journaled jobs of run `id` to fn(Job); returns the count.
+    template <class Fn>
+    int64_t load_queue(int id, Fn fn) {
+        sqlite3_stmt* st = nullptr;
+        const char* sql =
+          "SELECT ext_id,priority,attempt,max_retries,enqueue_ts,deadline_ts,"
+          "spec_service_ms,mlfq_level FROM queue WHERE run_id=?;";
+        if (sqlite3_prepare_v2(db.db, sql, -1, &st, nullptr) != SQLITE_OK) die("prepare load_queue");
+        if (sqlite3_bind_int(st, 1, id) != SQLITE_OK) die("bind load_queue");
+        int64_t n = 0;
+        while (sqlite3_step(st) == SQLITE_ROW) {
+            Job j;
+            j.ext_id = sqlite3_column_int(st, 0);
+            j.priority = (int16_t)sqlite3_column_int(st, 1);
+            j.attempt = (uint8_t)sqlite3_column_int(st, 2);
+            j.max_retries = (uint8_t)sqlite3_column_int(st, 3);
+            j.enqueue_ts = sqlite3_column_int64(st, 4);
+            j.deadline_ts = sqlite3_column_int64(st, 5);
+            j.spec_service_ms = sqlite3_column_int(st, 6);
+            j.mlfq_level = (uint8_t)sqlite3_column_int(st, 7);
+            fn(j);
+            n++;
+        }
+        sqlite3_finalize(st);
+        return n;
+    }
+
+    void end(int64_t end_ms) {
+        stop_writer();
+        sink->close();
+        run_end_ms = end_ms;
+    }
+
+    // Hot path: never touches SQLite. Only if the writer falls
+    // kMaxQueuedBatches behind does it wait, which keeps memory bounded when
+    // jobs complete faster than disk can absorb them (e.g. --virtual-clock).
+    static constexpr size_t kMaxQueuedBatches = 8;
+
+    // Records a caller collects locally and posts with complete_batch(), so a
+    // worker's batch of completions takes q_mu once instead of once per row.
+    // A null outbox posts straight away.
+    using Outbox = std::vector<Record>;
+
+    void record_job(const Job& j, Outbox* out = nullptr) {
+        if (job_rows) post(Record{Record::JobRow, j}, out);
+    }
+    void journal_put(const Job& j, Outbox* out = nullptr) {
+        if (journal) post(Record{Record::QueuePut, j}, out);
+    }
+    void journal_del(const Job& j, Outbox* out = nullptr) {
+        if (journal) post(Record{Record::QueueDel, j}, out);
+    }
+
+    void post(const Record& r, Outbox* out) {
+        if (out) out->push_back(r);
+        else enqueue(&r, 1);
+    }
+
+    // Posts and clears out; keeps its capacity for the next batch.
+    void complete_batch(Outbox& out) {
+        if (out.empty()) return;
+        enqueue(out.data(), out.size());
+        out.clear();
+    }
+
+    void enqueue(const Record* rs, size_t n) {
+        bool full;
+        {
+            std::unique_lock<std::mutex> lk(q_mu);
+            if (pending.size() >= batch_size * kMaxQueuedBatches) {
+                PROF_SCOPE(Phase::Db);  // stalled behind the writer
+                q_cv.notify_one();
+                room_cv.wait(lk, [&]{ return pending.size() < batch_size * kMaxQueuedBatches; });
+            }
+            pending.insert(pending.end(), rs, rs + n);
+            full = pending.size() >= batch_size;
+        }
+        if (full) q_cv.notify_one();
+    }
+
+    void stop_writer() {
+        {
+            std::lock_guard<std::mutex> lk(q_mu);
+            stopping = true;
+        }
+        q_cv.notify_one();
+        if (writer.joinable()) writer.join();
+    }
+
+    void writer_loop() {
+        std::vector<Record> batch;
+        std::unique_lock<std::mutex> lk(q_mu);
+        for (;;) {
+            // Wake on a full batch, on shutdown, or periodically so rows of a
+            // slow run still reach the database.
+            q_cv.wait_for(lk, Ms(200), [&]{
+                return stopping || pending.size() >= batch_size;
+            });
+            bool last = stopping;
+            batch.swap(pending);
+            room_cv.notify_all();
+            lk.unlock();
+            write_batch(batch);
+            batch.clear();
+            lk.lock();
+            if (last && pending.empty()) return;
+        }
+    }
+
+    // A file sink needs no transaction unless journal records share the
+    // batch; its rows are then handed to the OS before the COMMIT that
+    // removes their jobs from the queue table.
+    void write_batch(const std::vector<Record>& recs) {
+        PROF_SCOPE(Phase::Db);
+        for (size_t i = 0; i < recs.size(); i += batch_size) {
+            size_t n = std::min(batch_size, recs.size() - i);
+            bool txn = sink->in_db() || journal;
+            int64_t successes = 0, failures = 0;
+            if (txn) db.exec("BEGIN;");
+            for (size_t k = 0; k < n; ++k) {
+                const Record& r = recs[i + k];
+                switch (r.kind) {
+                    case Record::JobRow:   sink->write(run_id, r.job); break;
+                    case Record::QueuePut: write_queue_put(r.job); break;
+                    case Record::QueueDel:
+                        write_queue_del(r.job);
+                        successes += r.job.status == JobStatus::Success;
+                        failures += r.job.status == JobStatus::Failed;
+                        break;
+                }
+            }
+            if (successes + failures > 0) write_add_totals(successes, failures);
+            if (journal) sink->flush();
+            if (txn) db.exec("COMMIT;");
+        }
+    }
+
+    void write_add_totals(int64_t successes, int64_t failures) {
+        if (sqlite3_bind_int64(add_totals, 1, (sqlite3_int64)(successes + failures)) != SQLITE_OK ||
+            sqlite3_bind_int64(add_totals, 2, (sqlite3_int64)successes) != SQLITE_OK ||
+            sqlite3_bind_int64(add_totals, 3, (sqlite3_int64)failures) != SQLITE_OK ||
+            sqlite3_bind_int(add_totals, 4, run_id) != SQLITE_OK)
+            die("bind add_totals");
+        if (sqlite3_step(add_totals) != SQLITE_DONE) die("step add_totals");
+        sqlite3_reset(add_totals);
+    }
+
+    void write_queue_put(const Job& j) {
+        auto bind_int = [&](int idx, int v){
+            if (sqlite3_bind_int(put_queue, idx, v) != SQLITE_OK) die("bind_int queue");
+        };
+        auto bind_i64 = [&](int idx, int64_t v){
+            if (sqlite3_bind_int64(put_queue, idx, (sqlite3_int64)v) != SQLITE_OK) die("bind_i64 queue");
+        };
+        bind_int(1, run_id);
+        bind_int(2, j.ext_id);
+        bind_int(3, j.priority);
+        bind_int(4, j.attempt);
+        bind_int(5, j.max_retries);
+        bind_i64(6, j.enqueue_ts);
+        bind_i64(7, j.deadline_ts);
+        bind_int(8, j.spec_service_ms);
+        bind_int(9, j.mlfq_level);
+        if (sqlite3_step(put_queue) != SQLITE_DONE) die("step put_queue");
+        sqlite3_reset(put_queue);
+    }
+
+    void write_queue_del(const Job& j) {
+        if (sqlite3_bind_int(del_queue, 1, run_id) != SQLITE_OK) die("bind_int queue");
+        if (sqlite3_bind_int(del_queue, 2, j.ext_id) != SQLITE_OK) die("bind_int queue");
+        if (sqlite3_step(del_queue) != SQLITE_DONE) die("step del_queue");
+        sqlite3_reset(del_queue);
+    }
+
+    void record_run_summary(const RunSummary& r) {
+        auto bind_i64 = [&](int idx, int64_t v){
+            if (sqlite3_bind_int64(upd_run, idx, (sqlite3_int64)v) != SQLITE_OK) die("bind i64 run");
+        };
+        auto bind_int = [&](int idx, int v){
+            if (sqlite3_bind_int(upd_run, idx, v) != SQLITE_OK) die("bind int run");
+        };
+        auto bind_d = [&](int idx, double v){
+            if (sqlite3_bind_double(upd_run, idx, v) != SQLITE_OK) die("bind dbl run");
+        };
+
+        auto bind_pct = [&](int idx, const Percentiles& p){
+            bind_d(idx, p.p50);
+            bind_d(idx + 1, p.p90);
+            bind_d(idx + 2, p.p99);
+            bind_d(idx + 3, p.p999);
+        };
+
+        // A journaled run's totals were kept up to date batch by batch and
+        // cover every process that worked on it, not just this one.
+        RunTotals t;
+        t.total = r.total;
+        t.successes = r.successes;
+        t.failures = r.failures;
+        if (journal) load_run(run_id, t);
+        bind_i64(1, run_end_ms);
+        bind_i64(2, t.total);
+        bind_i64(3, t.successes);
+        bind_i64(4, t.failures);
+        bind_d(5, r.avg_wait);
+        bind_d(6, r.avg_service);
+        bind_d(7, r.avg_turn);
+        bind_d(8, r.throughput);
+        bind_pct(9, r.wait);
+        bind_pct(13, r.service);
+        bind_pct(17, r.turn);
+        if (sqlite3_bind_text(upd_run, 21, r.policy.c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK)
+            die("bind text run");
+        bind_int(22, r.deadline_misses);
+        bind_i64(23, (int64_t)r.seed);
+        if (sqlite3_bind_text(upd_run, 24, r.executor.c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK)
+            die("bind text run");
+        bind_int(25, r.max_inflight);
+        if (sqlite3_bind_text(upd_run, 26, r.sink.c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK)
+            die("bind text run");
+        bind_i64(27, r.rejected);
+        bind_i64(28, r.dropped);
+        if (r.first_dispatch_ms >= 0) bind_d(29, r.first_dispatch_ms);
+        bind_int(30, run_id);
+
+        if (sqlite3_step(upd_run) != SQLITE_DONE) die("step upd_run");
+        sqlite3_reset(upd_run);
+        sqlite3_clear_bindings(upd_run);
+    }
+};
+
+// --------------------------- Networking ---------------------------
+#ifdef _WIN32
+using socket_t = SOCKET;
+const socket_t kNoSocket = INVALID_SOCKET;
+inline void close_socket(socket_t s) { closesocket(s); }
+#else
+using socket_t = int;
+const socket_t kNoSocket = -1;
+inline void close_socket(socket_t s) { ::close(s); }
+#endif
+
+// Winsock needs one WSAStartup per process; a no-op elsewhere.
+void net_init() {
+#ifdef _WIN32
+    static bool done = []{
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+            std::cerr << "WSAStartup failed\n";
+            std::exit(1);
+        }
+        return true;
+    }();
+    (void)done;
+#endif
+}
+
+// Waits up to timeout_ms for s to become readable.
+bool wait_readable(socket_t s, int timeout_ms) {
+    fd_set rd;
+    FD_ZERO(&rd);
+    FD_SET(s, &rd);
+    timeval tv{timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+    return select((int)s + 1, &rd, nullptr, nullptr, &tv) > 0;
+}
+
+bool send_all(socket_t s, const char* p, size_t n) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;     // a dead peer is an error, not SIGPIPE
+#else
+    const int flags = 0;
+#endif
+    while (n > 0) {
+        int k = (int)send(s, p, (int)std::min<size_t>(n, 1 << 20), flags);
+        if (k <= 0) return false;
+        p += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+bool recv_all(socket_t s, char* p, size_t n) {
+    while (n > 0) {
+        int k = (int)recv(s, p, (int)std::min<size_t>(n, 1 << 20), 0);
+        if (k <= 0) return false;
+        p += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+// "host:port" -> connected TCP socket, or kNoSocket.
+socket_t connect_to(const std::string& endpoint) {
+    net_init();
+    size_t colon = endpoint.rfind(':');
+    if (colon == std::string::npos) return kNoSocket;
+    std::string host = endpoint.substr(0, colon), port = endpoint.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0) return kNoSocket;
+    socket_t s = kNoSocket;
+    for (addrinfo* ai = res; ai && s == kNoSocket; ai = ai->ai_next) {
+        s = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (s == kNoSocket) continue;
+        if (connect(s, ai->ai_addr, (int)ai->ai_addrlen) != 0) {
+            close_socket(s);
+            s = kNoSocket;
+        }
+    }
+    freeaddrinfo(res);
+    if (s != kNoSocket) {
+        int yes = 1;        // small frames: don't wait to coalesce them
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&yes, sizeof yes);
+    }
+    return s;
+}
+
+socket_t listen_on(int port, const char* what) {
+    net_init();
+    socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == kNoSocket) {
+        std::cerr << what << ": socket() failed\n";
+        std::exit(1);
+    }
+    int yes = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof yes);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    if (bind(s, (sockaddr*)&addr, sizeof addr) != 0 || listen(s, 64) != 0) {
+        std::cerr << what << ": cannot listen on port " << port << "\n";
+        std::exit(1);
+    }
+    return s;
+}
+
+// --------------------------- Wire protocol ---------------------------
+// Coordinator <-> remote worker frames: u32 payload length, u8 Msg, payload.
+// All integers little-endian.
+//   Hello     w->c  u32 version
+//   Welcome   c->w  u64 seed, i32 mean_ms, i32 stddev_ms, i32 heartbeat_ms,
+//                   u8 fail_steps, fail_steps x u64 fail_below,
+//                   i64 spike_from, i64 spike_to (ms from now), u64 spike_below
+//   LeaseReq  w->c  u32 max_jobs
+//   Lease     c->w  u32 n, then n x {u32 idx, i32 ext_id, i16 priority,
+//                   u8 attempt, u8 sampled, i32 service_ms}
+//   Result    w->c  u32 idx, u8 attempt, i32 service_ms, u16 len, reason
+//                   (len 0 = success)
+//   Heartbeat w->c  empty
+//   Shutdown  c->w  empty; the run is over
+enum class Msg : uint8_t { Hello = 1, Welcome, LeaseReq, Lease, Result, Heartbeat, Shutdown };
+constexpr uint32_t kProtocolVersion = 2;
+constexpr uint32_t kMaxFrame = 16 << 20;
+
+struct WireOut {
+    std::string buf;
+
+    void u8(uint8_t v) { buf.push_back((char)v); }
+    void u16(uint16_t v) { for (int i = 0; i < 2; ++i) u8((uint8_t)(v >> (8 * i))); }
+    void u32(uint32_t v) { for (int i = 0; i < 4; ++i) u8((uint8_t)(v >> (8 * i))); }
+    void u64(uint64_t v) { for (int i = 0; i < 8; ++i) u8((uint8_t)(v >> (8 * i))); }
+    void bytes(const std::string& s) { buf += s; }
+};
+
+// Reads from a received payload; any overrun sets `bad` and yields zeros.
+struct WireIn {
+    const std::string& buf;
+    size_t off = 0;
+    bool bad = false;
+
+    explicit WireIn(const std::string& b) : buf(b) {}
+
+    uint64_t le(int n) {
+        if (off + n > buf.size()) { bad = true; return 0; }
+        uint64_t v = 0;
+        for (int i = 0; i < n; ++i) v |= (uint64_t)(uint8_t)buf[off + i] << (8 * i);
+        off += n;
+        return v;
+    }
+    uint8_t u8() { return (uint8_t)le(1); }
+    uint16_t u16() { return (uint16_t)le(2); }
+    uint32_t u32() { return (uint32_t)le(4); }
+    uint64_t u64() { return le(8); }
+    std::string bytes(size_t n) {
+        if (off + n > buf.size()) { bad = true; return std::string(); }
+        std::string s = buf.substr(off, n);
+        off += n;
+        return s;
+    }
+};
+
+bool send_frame(socket_t s, Msg type, const std::string& payload = std::string()) {
+    WireOut h;
+    h.u32((uint32_t)payload.size());
+    h.u8((uint8_t)type);
+    h.bytes(payload);
+    return send_all(s, h.buf.data(), h.buf.size());
+}
+
+bool recv_frame(socket_t s, Msg& type, std::string& payload) {
+    char hdr[5];
+    if (!recv_all(s, hdr, sizeof hdr)) return false;
+    std::string h(hdr, sizeof hdr);
+    WireIn in(h);
+    uint32_t len = in.u32();
+    type = (Msg)in.u8();
+    if (len > kMaxFrame) return false;
+    payload.resize(len);
+    return len == 0 || recv_all(s, &payload[0], len);
+}
+
+// --------------------------- Metrics endpoint ---------------------------
+// Minimal HTTP/1.0-style listener for Prometheus scrapes: one thread, one
+// request per connection, GET /metrics answered with render()'s text and
+// anything else with 404.
+struct MetricsServer {
+    socket_t listener = kNoSocket;
+    std::atomic<bool> stopping{false};
+    std::function<std::string()> render;
+    std::thread th;
+
+    ~MetricsServer() { stop(); }
+
+    void start(int port, std::function<std::string()> r) {
+        render = std::move(r);
+        listener = listen_on(port, "--metrics-port");
+        stopping = false;
+        th = std::thread([this]{ loop(); });
+    }
+
+    void stop() {
+        stopping = true;
+        if (th.joinable()) th.join();
+        if (listener != kNoSocket) close_socket(listener);
+        listener = kNoSocket;
+    }
+
+    void loop() {
+        while (!stopping) {
+            if (!wait_readable(listener, 200)) continue;
+            socket_t c = accept(listener, nullptr, nullptr);
+            if (c == kNoSocket) continue;
+            serve(c);
+            close_socket(c);
+        }
+    }
+
+    void serve(socket_t c) {
+        std::string req;
+        char buf[1024];
+        while (req.find("\r\n\r\n") == std::string::npos && req.size() < 8192) {
+            if (!wait_readable(c, 1000)) return;
+            int n = (int)recv(c, buf, sizeof buf, 0);
+            if (n <= 0) return;
+            req.append(buf, (size_t)n);
+        }
+        bool ok = req.compare(0, 12, "GET /metrics") == 0;
+        std::string body = ok ? render() : std::string("not found\n");
+        std::string resp = std::string(ok ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 404 Not Found\r\n")
+            + "Content-Type: text/plain; version=0.0.4\r\n"
+            + "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            + "Connection: close\r\n\r\n" + body;
+        send_all(c, resp.data(), resp.size());
+    }
+};
+
+// --------------------------- Executors ---------------------------
+// What an attempt actually does. execute() runs one attempt of j and returns
+// kReasonNone on success or the interned failure reason. On entry
+// j.service_ms holds the sampled service time; real executors overwrite it
+// with the measured duration. Each worker calls execute() concurrently, so
+// --workers is also the number of overlapping executions.
+struct Executor {
+    virtual ~Executor() = default;
+    virtual const char* name() const = 0;
+    virtual bool simulated() const { return false; }
+    virtual uint16_t execute(Job& j, RNG& r) = 0;
+};
+
+// Default: sleep for the sampled service time, fail per RNG::should_fail.
+// --virtual-clock uses outcome() directly and skips the sleep.
+struct SimulatedExecutor : Executor {
+    const char* name() const override { return "sim"; }
+    bool simulated() const override { return true; }
+
+    static uint16_t outcome(const Job& j, RNG& r) {
+        return r.should_fail(j.attempt, j.start_ts) ? kReasonSimulated : kReasonNone;
+    }
+    uint16_t execute(Job& j, RNG& r) override {
+        std::this_thread::sleep_for(Ms(j.service_ms));
+        return outcome(j, r);
+    }
+};
+
+// Registered C++ tasks for --executor task:<name>. A task returns false and
+// fills `error` to fail the attempt; the text becomes its fail_reason.
+// Register before Dispatcher::run().
+using TaskFn = std::function<bool(const Job& j, std::string& error)>;
+
+std::unordered_map<std::string, TaskFn>& task_registry() {
+    static std::unordered_map<std::string, TaskFn> r{
+        // Stays on-CPU for the sampled service time: a CPU-bound stand-in.
+        {"spin", [](const Job& j, std::string&){
+            auto until = Clock::now() + Ms(j.service_ms);
+            uint64_t x = (uint64_t)j.ext_id;
+            while (Clock::now() < until)
+                for (int i = 0; i < 1000; ++i) x = x * 6364136223846793005ULL + 1;
+            return x != 0 || j.ext_id != 0;
+        }},
+        {"noop", [](const Job&, std::string&){ return true; }},
+    };
+    return r;
+}
+
+void register_task(const std::string& name, TaskFn fn) {
+    task_registry()[name] = std::move(fn);
+}
+
+int elapsed_ms(Clock::time_point t0) {
+    return (int)std::chrono::duration_cast<Ms>(Clock::now() - t0).count();
+}
+
+struct CallableExecutor : Executor {
+    std::string label;      // "task:<name>"
+    TaskFn fn;
+
+    CallableExecutor(const std::string& task, TaskFn f) : label("task:" + task), fn(std::move(f)) {}
+
+    const char* name() const override { return label.c_str(); }
+
+    uint16_t execute(Job& j, RNG&) override {
+        std::string error;
+        auto t0 = Clock::now();
+        bool ok;
+        try {
+            ok = fn(j, error);
+        } catch (const std::exception& e) {
+            ok = false;
+            error = std::string("EXCEPTION: ") + e.what();
+        }
+        j.service_ms = elapsed_ms(t0);
+        if (ok) return kReasonNone;
+        return reasons().intern(error.empty() ? "TASK_FAILED" : error);
+    }
+};
+
+// --executor shell: runs --command through the system shell per attempt,
+// with {id}, {attempt}, {priority} and {service_ms} substituted. Exit status
+// 0 is success; anything else fails as EXIT_<code> (or SIGNAL_<n>).
+struct ShellExecutor : Executor {
+    std::string command;
+
+    explicit ShellExecutor(const std::string& cmd) : command(cmd) {}
+
+    const char* name() const override { return "shell"; }
+
+    std::string expand(const Job& j) const {
+        std::string out;
+        out.reserve(command.size() + 32);
+        for (size_t i = 0; i < command.size(); ++i) {
+            auto field = [&](const char* key, long long v){
+                size_t n = std::strlen(key);
+                if (command.compare(i, n, key) != 0) return false;
+                out += std::to_string(v);
+                i += n - 1;
+                return true;
+            };
+            if (command[i] == '{' &&
+                (field("{id}", j.ext_id) || field("{attempt}", j.attempt) ||
+                 field("{priority}", j.priority) || field("{service_ms}", j.service_ms)))
+                continue;
+            out.push_back(command[i]);
+        }
+        return out;
+    }
+
+    uint16_t execute(Job& j, RNG&) override {
+        std::string cmd = expand(j);
+        auto t0 = Clock::now();
+        int rc = std::system(cmd.c_str());
+        j.service_ms = elapsed_ms(t0);
+        if (rc == -1) return reasons().intern("SPAWN_FAILED");
+#ifndef _WIN32
+        if (WIFSIGNALED(rc)) return reasons().intern("SIGNAL_" + std::to_string(WTERMSIG(rc)));
+        rc = WIFEXITED(rc) ? WEXITSTATUS(rc) : rc;
+#endif
+        if (rc == 0) return kReasonNone;
+        return reasons().intern("EXIT_" + std::to_string(rc));
+    }
+};
+
+std::unique_ptr<Executor> make_executor(const std::string& name, const std::string& command) {
+    if (name == "sim") return std::unique_ptr<Executor>(new SimulatedExecutor());
+    if (name == "shell") {
+        if (command.empty()) {
+            std::cerr << "--executor shell needs --command\n";
+            std::exit(1);
+        }
+        return std::unique_ptr<Executor>(new ShellExecutor(command));
+    }
+    if (name.compare(0, 5, "task:") == 0) {
+        auto it = task_registry().find(name.substr(5));
+        if (it != task_registry().end())
+            return std::unique_ptr<Executor>(new CallableExecutor(it->first, it->second));
+        std::cerr << "Unknown task: " << name.substr(5) << " (registered:";
+        for (const auto& t : task_registry()) std::cerr << " " << t.first;
+        std::cerr << ")\n";
+        std::exit(1);
+    }
+    std::cerr << "Unknown --executor: " << name << "\n";
+    std::exit(1);
+}
+
+// --------------------------- CPU placement ---------------------------
+// --pin-workers: the CPU each worker thread binds itself to.
+//   compact - fill one NUMA node's CPUs before moving to the next
+//   spread  - round-robin across nodes, so each node's cores, caches and
+//             memory bandwidth are used before any node doubles up
+// Workers beyond the CPU count wrap around. A worker pins itself before it
+// first touches its stats, RNG and batch buffers, so first-touch places those
+// pages on its own node. The job pool and scheduler stay shared: jobs move
+// between workers through them.
+struct CpuTopology {
+    std::vector<std::vector<int>> nodes;    // usable CPUs, per NUMA node
+
+    int cpus() const {
+        int n = 0;
+        for (const auto& node : nodes) n += (int)node.size();
+        return n;
+    }
+
+    // "0-3,8,10-11" as in /sys/devices/system/node/*/cpulist.
+    static std::vector<int> parse_list(const std::string& s) {
+        std::vector<int> out;
+        const char* p = s.c_str();
+        while (*p) {
+            char* end = nullptr;
+            long lo = std::strtol(p, &end, 10);
+            if (end == p) break;
+            long hi = lo;
+            p = end;
+            if (*p == '-') {
+                hi = std::strtol(p + 1, &end, 10);
+                p = end;
+            }
+            for (long c = lo; c <= hi; ++c) out.push_back((int)c);
+            if (*p == ',') ++p;
+            else break;
+        }
+        return out;
+    }
+
+    static CpuTopology detect() {
+        CpuTopology t;
+#if defined(__linux__)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool masked = sched_getaffinity(0, sizeof allowed, &allowed) == 0;
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string list;
+        if (online && std::getline(online, list))
+            for (int n : parse_list(list)) {
+                std::ifstream f("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+                std::string cpus;
+                if (!f || !std::getline(f, cpus)) continue;
+                std::vector<int> node;
+                for (int c : parse_list(cpus))
+                    if (!masked || (c < CPU_SETSIZE && CPU_ISSET(c, &allowed))) node.push_back(c);
+                if (!node.empty()) t.nodes.push_back(std::move(node));
+            }
+        if (t.nodes.empty() && masked) {
+            std::vector<int> node;
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (CPU_ISSET(c, &allowed)) node.push_back(c);
+            if (!node.empty()) t.nodes.push_back(std::move(node));
+        }
+#elif defined(_WIN32)
+        ULONG highest = 0;
+        if (GetNumaHighestNodeNumber(&highest))
+            for (ULONG n = 0; n <= highest; ++n) {
+                ULONGLONG mask = 0;
+                if (!GetNumaNodeProcessorMask((UCHAR)n, &mask) || !mask) continue;
+                std::vector<int> node;
+                for (int c = 0; c < 64; ++c)
+                    if (mask >> c & 1) node.push_back(c);
+                t.nodes.push_back(std::move(node));
+            }
+#endif
+        if (t.nodes.empty()) {
+            std::vector<int> node;
+            for (int c = 0; c < (int)std::max(1u, std::thread::hardware_concurrency()); ++c)
+                node.push_back(c);
+            t.nodes.push_back(std::move(node));
+        }
+        return t;
+    }
+
+    // CPU for each of `workers` threads under --pin-workers `mode`.
+    std::vector<int> plan(int workers, const std::string& mode) const {
+        std::vector<int> order;
+        if (mode == "compact") {
+            for (const auto& node : nodes) order.insert(order.end(), node.begin(), node.end());
+        } else {
+            for (size_t i = 0; (int)order.size() < cpus(); ++i)
+                for (const auto& node : nodes)
+                    if (i < node.size()) order.push_back(node[i]);
+        }
+        std::vector<int> out((size_t)std::max(0, workers));
+        for (size_t w = 0; w < out.size(); ++w) out[w] = order[w % order.size()];
+        return out;
+    }
+};
+
+void check_pin_mode(const std::string& mode) {
+    if (mode == "off" || mode == "compact" || mode == "spread") return;
+    std::cerr << "Unknown --pin-workers: " << mode << " (expected off, compact or spread)\n";
+    std::exit(1);
+}
+
+// Binds the calling thread to `cpu`. False where unsupported (macOS) or
+// refused.
+bool pin_this_thread(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+#elif defined(_WIN32)
+    if (cpu < 0 || cpu >= 64) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// --------------------------- Dispatcher ---------------------------
+// Per-worker counters; each worker owns one and they are merged after join,
+// so the hot path never touches shared state for bookkeeping. Cache-line
+// aligned so neighbouring workers' stats never share a line.
+struct alignas(64) WorkerStats {
+    int successes = 0;
+    int failures = 0;
+    int64_t total_wait = 0;
+    int64_t total_service = 0;
+    int64_t total_turn = 0;
+    int64_t busy_ms = 0;        // service time of every attempt, incl. failures
+    int deadline_misses = 0;    // terminal (success or final failure) after deadline_ts
+    LatencyHistogram wait_h, service_h, turn_h;  // every attempt
+    LatencyHistogram job_h;     // successful jobs: first enqueue to success
+
+    void merge(const WorkerStats& o) {
+        successes += o.successes;
+        failures += o.failures;
+        total_wait += o.total_wait;
+        total_service += o.total_service;
+        total_turn += o.total_turn;
+        busy_ms += o.busy_ms;
+        deadline_misses += o.deadline_misses;
+        wait_h.merge(o.wait_h);
+        service_h.merge(o.service_h);
+        turn_h.merge(o.turn_h);
+        job_h.merge(o.job_h);
+    }
+};
+
+// Bounded ring of the most recent jobs pushed into it; older entries are
+// overwritten, so memory is fixed at `cap` jobs for any run length.
+struct JobRing {
+    std::mutex mu;
+    std::vector<Job> buf;
+    size_t cap = 0;
+    size_t next = 0;        // slot the next push overwrites
+    uint64_t pushed = 0;
+
+    explicit JobRing(int capacity) : cap((size_t)std::max(0, capacity)) {
+        buf.reserve(cap);
+    }
+
+    void push(const Job& j) {
+        if (cap == 0) return;
+        std::lock_guard<std::mutex> lk(mu);
+        if (buf.size() < cap) buf.push_back(j);
+        else buf[next] = j;
+        next = (next + 1) % cap;
+        pushed++;
+    }
+
+    // Oldest first.
+    std::vector<Job> snapshot() {
+        std::lock_guard<std::mutex> lk(mu);
+        if (buf.size() < cap) return buf;
+        std::vector<Job> out(buf.begin() + next, buf.end());
+        out.insert(out.end(), buf.begin(), buf.begin() + next);
+        return out;
+    }
+};
+
+struct Dispatcher {
+    // First, so it is taken before the database opens: startup is measured
+    // from here to the first attempt (first_dispatch_us).
+    const Clock::time_point created = Clock::now();
+    Args args;
+    RNG rng;
+    DB db;
+    RunRecorder rec;
+    SimClock clock;
+
+    JobPool pool;
+    DedupIndex dedup;
+    Scheduler sched;                     // after clock and pool: mlfq reads the clock
+    RetryTimer retries;
+    JobRing recent_failures;
+    std::unique_ptr<Executor> executor;
+    RetryPolicy retry_policy;
+    std::vector<double> fail_probs;      // --fail-probs; empty = RNG defaults
+    FailSpike fail_spike;
+
+    // The two counters every worker writes get a cache line each.
+    alignas(64) std::atomic<int64_t> outstanding{0}; // jobs not yet in a terminal state
+    alignas(64) std::atomic<int64_t> inflight{0};    // attempts running (--max-inflight modes)
+    alignas(64) std::atomic<int> pin_failures{0};
+    std::atomic<int64_t> first_dispatch_us{-1}; // wall clock, created to first attempt
+    double seed_ms = 0;                  // wall time of seed_jobs / restore_queue
+    CpuTopology topology;                // detected only with --pin-workers
+    std::vector<int> worker_cpus;        // --pin-workers plan; empty = unpinned
+    std::atomic<int64_t> peak_inflight{0};
+    std::atomic<int64_t> rejected{0};    // --max-queue admission outcomes
+    std::atomic<int64_t> dropped{0};
+    std::atomic<bool> producing{false};  // a source is still feeding jobs
+    std::unique_ptr<JobSource> source;
+    JournalSource* journal_source = nullptr; // `source` when it replays a journal
+    int64_t source_t0 = 0;               // arrival offsets are relative to this
+    LogLevel log_level;
+    enum class Overload { Block, Reject, Shed } overload = Overload::Block;
+
+    // Virtual-clock mode: attempt completions and retry expiries become
+    // events on one heap and the loop jumps `clock.vnow` from one to the next.
+    struct SimEvent {
+        enum Kind : uint8_t { Complete, RetryDue, Arrival };
+        int64_t t;
+        uint64_t seq;   // FIFO among equal times
+        Kind kind;
+        uint16_t reason; // outcome of a Complete, sampled at start
+        uint32_t idx;   // JobPool index; unused for Arrival
+    };
+    struct SimEventLater {
+        bool operator()(SimEvent const& a, SimEvent const& b) const {
+            if (a.t != b.t) return a.t > b.t;
+            return a.seq > b.seq;
+        }
+    };
+    std::priority_queue<SimEvent, std::vector<SimEvent>, SimEventLater> events;
+    uint64_t next_event_seq = 0;
+
+    RunSummary summary;                  // filled in by run()
+    RunRecorder::RunTotals resumed;      // --resume: the runs row as we found it
+
+    std::unique_ptr<LiveMetrics> live;   // only with --metrics-port
+    MetricsServer metrics;               // last: its thread reads the members above
+
+    // Resolves --seed 0 to a random seed so every run records the seed that
+    // reproduces it. --resume without --seed keeps the resumed run's seed
+    // instead (see the constructor), so its jobs draw the same streams.
+    static Args with_seed(Args a) {
+        if (a.seed == 0) {
+            std::random_device rd;
+            a.seed = ((uint64_t)rd() << 32 | rd()) | 1;
+        }
+        return a;
+    }
+
+    Dispatcher(const Args& a)
+      : args(with_seed(a)), rng(a.mean_ms, a.stddev_ms, args.seed), db(a.db),
+        rec(db, a.db_batch, make_sink(a.sink, db, a.db)),
+        sched(pool, make_policy(a.policy, clock, a.mlfq_boost_ms)),
+        recent_failures(a.keep_failures), log_level(parse_log_level(a.log_level)) {
+        clock.is_virtual = a.virtual_clock;
+        rec.job_rows = a.job_rows;
+        if (a.resume > 0) {
+            if (!rec.load_run(a.resume, resumed)) {
+                std::cerr << "--resume: no run with run_id=" << a.resume << "\n";
+                std::exit(1);
+            }
+            if (a.seed == 0 && resumed.seed != 0) {
+                args.seed = resumed.seed;
+                rng = RNG(args.mean_ms, args.stddev_ms, args.seed);
+            }
+        }
+        dedup.mode = DedupIndex::parse_mode(a.dedup);
+        dedup.raises = a.policy != "mlfq";
+        if (dedup.mode != DedupIndex::Mode::Off) sched.dedup = &dedup;
+        check_pin_mode(a.pin_workers);
+        // Only real-time local workers are pinned: virtual runs are one
+        // thread and coordinator threads wait on sockets.
+        if (a.pin_workers != "off" && !a.virtual_clock && a.coordinator_port <= 0) {
+            topology = CpuTopology::detect();
+            worker_cpus = topology.plan(std::max(1, a.workers), a.pin_workers);
+        }
+        if (a.batch < 1) {
+            std::cerr << "--batch must be at least 1\n";
+            std::exit(1);
+        }
+        // The queue journal is keyed by ext_id, so two queued instances of
+        // one ext_id would share a row and the first to finish would delete
+        // the other's. Only --input traces can repeat an ext_id, and --dedup
+        // keeps each one in the system at most once.
+        if (a.journal && !a.input.empty() && dedup.mode == DedupIndex::Mode::Off) {
+            std::cerr << "--journal with --input needs --dedup merge or reject: "
+                         "the journal holds one row per ext_id\n";
+            std::exit(1);
+        }
+        logger().rate.store(a.log_rate);
+        if (a.metrics_port > 0) live.reset(new LiveMetrics());
+        executor = make_executor(a.executor, a.command);
+        if (a.virtual_clock && !executor->simulated()) {
+            std::cerr << "--virtual-clock only simulates time; it cannot drive --executor "
+                      << a.executor << "\n";
+            std::exit(1);
+        }
+        if (a.coordinator_port > 0 && (a.virtual_clock || a.max_inflight > 0)) {
+            std::cerr << "--coordinator runs in real time with remote workers; it cannot be "
+                         "combined with --virtual-clock or --max-inflight\n";
+            std::exit(1);
+        }
+        if (a.max_inflight > 0 && !executor->simulated()) {
+            std::cerr << "--max-inflight needs --executor sim; " << a.executor
+                      << " attempts block their thread, so use --workers instead\n";
+            std::exit(1);
+        }
+        retry_policy.jitter = RetryPolicy::parse_jitter(a.jitter);
+        retry_policy.base_ms = std::max(1, a.backoff_base_ms);
+        retry_policy.cap_ms = std::max(0, a.backoff_cap_ms);
+        retry_policy.seed = args.seed;
+        retry_policy.budget = std::max(0.0, a.retry_budget);
+        retry_policy.threshold = std::max(0.0, a.breaker_threshold);
+        retry_policy.window_ms = std::max(1, a.breaker_window_ms);
+        retry_policy.open_ms = std::max(0, a.breaker_open_ms);
+        fail_probs = parse_fail_probs(a.fail_probs);
+        fail_spike = parse_fail_spike(a.fail_spike);
+        if (a.overload == "block") overload = Overload::Block;
+        else if (a.overload == "reject") overload = Overload::Reject;
+        else if (a.overload == "shed") overload = Overload::Shed;
+        else {
+            std::cerr << "Unknown --overload: " << a.overload << " (expected block, reject or shed)\n";
+            std::exit(1);
+        }
+        if (a.resume > 0) {
+            // A resumed run's jobs all come from its journal (restore_queue());
+            // a source would admit a second batch with colliding ext_ids.
+            if (!a.input.empty() || a.arrival_rate > 0) {
+                std::cerr << "--resume restores the journaled queue; it cannot be combined "
+                             "with --input or --arrival-rate\n";
+                std::exit(1);
+            }
+        } else if (!a.input.empty()) {
+            source.reset(new JsonlSource(a.input));
+        } else if (a.arrival_rate > 0) {
+            source.reset(new ArrivalSource(a.jobs, a.arrival_rate, a.arrival_dist,
+                                           a.burst_on_ms, a.burst_off_ms, args.seed));
+        } else if (a.max_queue > 0) {
+            source.reset(new BatchSource(a.jobs));
+        }
+    }
+
+    bool finished() const { return !producing.load() && outstanding.load() == 0; }
+
+    // Only called from the ingesting thread, which owns `rng`. The priority
+    // draw comes from a stream keyed by ext_id, so any RNG with the run's
+    // seed yields the same job.
+    Job make_job(const JobSpec& spec, int64_t enqueue_ts) { return make_job(spec, enqueue_ts, rng); }
+    Job make_job(const JobSpec& spec, int64_t enqueue_ts, RNG& r) const {
+        Job j;
+        j.ext_id = spec.ext_id;
+        r.begin(spec.ext_id, RNG::kPriorityStream);
+        j.priority = (int16_t)(spec.priority > 0 ? std::min(10, spec.priority)
+                                                   : r.priority());
+        j.max_retries = (uint8_t)std::min(255, std::max(0, args.max_retries));
+        j.spec_service_ms = std::max(0, spec.service_ms);
+        j.enqueue_ts = enqueue_ts;
+        // Without an explicit deadline, lower priorities get proportionally
+        // more slack: priority 10 gets deadline_ms, priority 1 gets 10x.
+        int rel = spec.deadline_ms >= 0 ? spec.deadline_ms
+                                         : args.deadline_ms * (11 - j.priority);
+        j.deadline_ts = enqueue_ts + rel;
+        return j;
+    }
+
+    // Hands an arrived job to the scheduler. enqueue_ts is its nominal
+    // arrival time, so time spent held back by the ingest window counts as
+    // wait.
+    void admit(const JobSpec& spec) {
+        if (journal_source) enqueue_restored(journal_source->last());
+        else enqueue_new(make_job(spec, source_t0 + spec.arrival_ms));
+    }
+
+    // Journals before pushing so the put cannot land after the job's delete.
+    // With --dedup, an ext_id already in the system is merged or rejected
+    // first. With --max-queue and a full queue, reject turns the new job
+    // away and shed drops whichever of it and the queued jobs ranks lowest
+    // under JobCmp (block never gets here full: the producer waits first).
+    void enqueue_new(const Job& j) {
+        uint32_t idx = pool.acquire();
+        if (dedup.mode != DedupIndex::Mode::Off) {
+            auto raise = [this](uint32_t slot, int16_t priority) {
+                uint32_t fresh = sched.raise(slot, priority);
+                rec.journal_put(pool[fresh]);
+                return fresh;
+            };
+            DedupIndex::Admit verdict = dedup.admit(j, idx, raise);
+            if (verdict != DedupIndex::Admit::New) {
+                pool.release(idx);
+                if (verdict == DedupIndex::Admit::Rejected)
+                    turn_away(j, JobStatus::Rejected, kReasonDuplicate);
+                return;
+            }
+        }
+        uint32_t victim = UINT32_MAX;
+        if (args.max_queue > 0 && overload != Overload::Block
+            && sched.size() >= args.max_queue) {
+            if (overload == Overload::Reject || !sched.shed_below(j, victim)) {
+                pool.release(idx);
+                if (dedup.mode != DedupIndex::Mode::Off) dedup.forget(j.ext_id);
+                turn_away(j, overload == Overload::Reject ? JobStatus::Rejected : JobStatus::Dropped);
+                return;
+            }
+        }
+        pool[idx] = j;
+        outstanding.fetch_add(1);
+        rec.journal_put(j);
+        sched.push(idx);
+        if (victim != UINT32_MAX) {
+            Job v = pool[victim];
+            pool.release(victim);
+            if (dedup.mode != DedupIndex::Mode::Off) dedup.forget(v.ext_id);
+            rec.journal_del(v);
+            turn_away(v, JobStatus::Dropped);
+            outstanding.fetch_sub(1);  // cannot reach 0: the new job is queued
+        }
+    }
+
+    // Records a job that ends without (another) attempt.
+    void turn_away(Job j, JobStatus status, uint16_t reason = kReasonNone) {
+        j.status = status;
+        j.fail_reason = reason;
+        j.start_ts = j.end_ts = clock.now();
+        j.wait_ms = j.service_ms = 0;
+        j.turnaround_ms = (int)(j.end_ts - j.enqueue_ts);
+        if (status == JobStatus::Rejected) rejected.fetch_add(1);
+        else dropped.fetch_add(1);
+        if (live) live->add(status == JobStatus::Rejected ? live->rejected : live->dropped);
+        rec.record_job(j);
+        log_console(j);
+    }
+
+    // Whether the producer must wait before admitting another job: the
+    // ingest window, or --max-queue under --overload block. reject and shed
+    // never wait; --max-queue bounds the queue instead. Journaled jobs of a
+    // resumed run were admitted once already, so they always wait rather
+    // than be turned away.
+    bool ingest_window_full() const {
+        if (args.max_queue > 0)
+            return (overload == Overload::Block || journal_source)
+                && sched.size() >= args.max_queue;
+        return sched.size() >= std::max(1, args.ingest_window);
+    }
+
+    // Real-time ingestion thread: sleeps until each spec's arrival, and pauses
+    // while the scheduler already holds ingest_window jobs, so memory stays
+    // bounded however large the trace is.
+    void ingest_loop() {
+        JobSpec spec;
+        while (source->next(spec)) {
+            int64_t due = source_t0 + spec.arrival_ms;
+            int64_t wait = due - clock.now();
+            if (wait > 0) std::this_thread::sleep_for(Ms(wait));
+            while (ingest_window_full()) std::this_thread::sleep_for(Ms(1));
+            admit(spec);
+        }
+        producing.store(false);
+        sched.wake_all();
+    }
+
+    // Closed batch of --jobs: generated straight into consecutive pool
+    // slots, split across threads for large runs, then handed to the
+    // scheduler in one push_bulk (an O(n) heapify per heap) instead of n
+    // pushes. Same jobs, in the same pop order, as admitting them one by one.
+    void seed_jobs() {
+        constexpr uint32_t kPerThread = 1 << 16;
+        int64_t t0 = clock.now();
+        uint32_t n = (uint32_t)std::max(0, args.jobs);
+        if (n == 0) return;
+        uint32_t first = pool.acquire_run(n);
+        auto fill = [this, first, t0](uint32_t lo, uint32_t hi) {
+            RNG r = make_rng();
+            JobSpec spec;
+            for (uint32_t i = lo; i < hi; ++i) {
+                spec.ext_id = (int)i + 1;
+                pool[first + i] = make_job(spec, t0 + i + 1, r); // stable ordering
+            }
+        };
+        uint32_t nthreads = std::min<uint32_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                               (n + kPerThread - 1) / kPerThread);
+        if (nthreads <= 1) {
+            fill(0, n);
+        } else {
+            std::vector<std::thread> threads;
+            uint32_t step = (n + nthreads - 1) / nthreads;
+            for (uint32_t lo = 0; lo < n; lo += step)
+                threads.emplace_back(fill, lo, std::min(n, lo + step));
+            for (auto& t : threads) t.join();
+        }
+        outstanding.fetch_add(n);
+        for (uint32_t i = first; i < first + n; ++i) {
+            if (dedup.mode != DedupIndex::Mode::Off)
+                dedup.admit(pool[i], i, [](uint32_t slot, int16_t){ return slot; });
+            rec.journal_put(pool[i]);
+        }
+        sched.push_bulk(first, n);
+    }
+
+    // Rebuilds the scheduler from run `args.resume`'s journal. Timestamps
+    // from the dead process's clock are shifted so the oldest job was
+    // enqueued now; relative order and deadline slack are kept. With
+    // --max-queue the jobs become a JournalSource and enter through the
+    // admission limit instead of all at once.
+    int64_t restore_queue() {
+        std::vector<Job> jobs;
+        int64_t n = rec.load_queue(args.resume, [&](const Job& j){ jobs.push_back(j); });
+        int64_t oldest = INT64_MAX;
+        for (const Job& j : jobs) oldest = std::min(oldest, j.enqueue_ts);
+        int64_t shift = clock.now() - oldest;
+        for (Job& j : jobs) {
+            j.enqueue_ts += shift;
+            j.deadline_ts += shift;
+        }
+        if (args.max_queue > 0) {
+            journal_source = new JournalSource();
+            journal_source->jobs = std::move(jobs);
+            source.reset(journal_source);
+            return n;
+        }
+        for (const Job& j : jobs) enqueue_restored(j);
+        return n;
+    }
+
+    // A journaled job back in the scheduler; its queue row already exists.
+    void enqueue_restored(const Job& j) {
+        uint32_t idx = pool.acquire();
+        pool[idx] = j;
+        outstanding.fetch_add(1);
+        // Journal rows are unique per ext_id (see the --journal check in
+        // the constructor), so each is new to the index.
+        if (dedup.mode != DedupIndex::Mode::Off)
+            dedup.admit(j, idx, [](uint32_t slot, int16_t){ return slot; });
+        sched.push(idx);
+    }
+
+    // An RNG for one thread, with this run's failure model.
+    RNG make_rng() const {
+        RNG r(args.mean_ms, args.stddev_ms, args.seed);
+        configure_rng(r);
+        return r;
+    }
+    void configure_rng(RNG& r) const {
+        r.set_fail_probs(fail_probs);
+        if (fail_spike.active())
+            r.set_spike(source_t0 + fail_spike.from_ms, source_t0 + fail_spike.to_ms, fail_spike.p);
+    }
+
+    // A job re-entering the scheduler (retry due, lease lost): its waits
+    // restart from now, and since_first_ms keeps the time already spent.
+    void requeue(uint32_t idx, int64_t now) {
+        Job& j = pool[idx];
+        j.since_first_ms += (int32_t)(now - j.enqueue_ts);
+        j.enqueue_ts = now;
+        if (dedup.mode == DedupIndex::Mode::Off) sched.push(idx);
+        else dedup.requeue(j, [&]{ sched.push(idx); });
+    }
+
+    void push_event(int64_t t, SimEvent::Kind kind, uint32_t idx,
+                    uint16_t reason = kReasonNone) {
+        events.push(SimEvent{t, next_event_seq++, kind, reason, idx});
+    }
+
+    // Parks a failed job until its backoff expires; it then re-enters the
+    // scheduler with a fresh enqueue_ts, so its wait_ms measures queueing
+    // after it became ready again rather than the backoff itself.
+    void park_retry(uint32_t idx) {
+        PROF_SCOPE(Phase::Backoff);
+        int64_t due = clock.now() + retry_policy.backoff_ms(pool[idx]);
+        if (clock.is_virtual) push_event(due, SimEvent::RetryDue, idx);
+        else retries.schedule(idx, due);
+    }
+
+    // Marks j running now and samples its service time. Leaves r on the
+    // attempt's stream, so the caller's should_fail() is reproducible too.
+    int start_attempt(Job& j, RNG& r) {
+        if (first_dispatch_us.load(std::memory_order_relaxed) < 0) mark_first_dispatch();
+        r.begin(j.ext_id, j.attempt);
+        if (live) {
+            live->in_flight.fetch_add(1, std::memory_order_relaxed);
+            live->add(live->attempts);
+        }
+        j.start_ts = clock.now();
+        j.status = JobStatus::Running;
+        j.wait_ms = (int)(j.start_ts - j.enqueue_ts);
+        j.service_ms = j.spec_service_ms > 0 ? j.spec_service_ms : r.service_ms();
+        return j.service_ms;
+    }
+
+    void mark_first_dispatch() {
+        int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - created).count();
+        int64_t none = -1;
+        first_dispatch_us.compare_exchange_strong(none, us);
+    }
+
+    // Completes the attempt begun by start_attempt with the executor's
+    // outcome (kReasonNone = success). Returns true if the job must be
+    // retried. Records go to `out` if given, else straight to the recorder.
+    bool finish_attempt(Job& j, uint16_t reason, WorkerStats& st,
+                        RunRecorder::Outbox* out = nullptr) {
+        bool fail = reason != kReasonNone;
+        j.end_ts = clock.now();
+        j.turnaround_ms = (int)(j.end_ts - j.enqueue_ts);
+        st.busy_ms += j.service_ms;
+        st.wait_h.record(j.wait_ms);
+        st.service_h.record(j.service_ms);
+        st.turn_h.record(j.turnaround_ms);
+        bool retry = fail && j.attempt < j.max_retries;
+        if (retry_policy.on_outcome(j.end_ts, fail, retry) != RetryPolicy::Verdict::Retry)
+            retry = false;
+        if (live) {
+            live->in_flight.fetch_sub(1, std::memory_order_relaxed);
+            live->wait.observe(j.wait_ms);
+            live->turnaround.observe(j.turnaround_ms);
+            if (!fail) live->add(live->successes);
+            else if (retry) live->add(live->retries);
+            else live->add(live->failures);
+        }
+
+        if (!fail) {
+            j.status = JobStatus::Success;
+            st.successes++;
+            st.total_wait += j.wait_ms;
+            st.total_service += j.service_ms;
+            st.total_turn += j.turnaround_ms;
+            st.job_h.record(j.since_first_ms + j.turnaround_ms);
+            if (j.end_ts > j.deadline_ts) st.deadline_misses++;
+            if (dedup.mode != DedupIndex::Mode::Off) dedup.set_state(j.ext_id, DedupIndex::State::Done);
+            rec.record_job(j, out);
+            rec.journal_del(j, out);
+            log_console(j);
+            return false;
+        }
+
+        j.status = JobStatus::Failed;
+        j.fail_reason = reason;
+        rec.record_job(j, out);
+        log_console(j);
+
+        if (retry) {
+            j.attempt += 1;
+            j.status = JobStatus::Pending;
+            j.fail_reason = kReasonNone;
+            // Re-enqueue with slight priority aging to avoid starvation
+            j.priority = (int16_t)std::min(10, j.priority + 1);
+            j.mlfq_level = (uint8_t)std::min(MlfqPolicy::kLevels - 1, j.mlfq_level + 1);
+            if (dedup.mode != DedupIndex::Mode::Off) dedup.set_state(j.ext_id, DedupIndex::State::Backoff);
+            rec.journal_put(j, out);
+            return true;
+        }
+        if (dedup.mode != DedupIndex::Mode::Off) dedup.forget(j.ext_id);
+        st.failures++;
+        rec.journal_del(j, out);
+        if (j.end_ts > j.deadline_ts) st.deadline_misses++;
+        recent_failures.push(j);
+        return false;
+    }
+
+    void worker_loop(WorkerStats& st) {
+        // Each worker samples from its own RNG; generators are not thread-safe.
+        RNG wrng = make_rng();
+        auto done = [this]{ return finished(); };
+        // --batch: up to k ready jobs per scheduler pop, run back to back,
+        // then their records are posted in one go. Retries are parked only
+        // after that, so a retry's journal put cannot land after its delete.
+        size_t k = (size_t)args.batch;
+        std::vector<uint32_t> idxs(k), again;
+        again.reserve(k);
+        RunRecorder::Outbox out;
+        out.reserve(2 * k);
+        while (size_t n = sched.pop_wait_batch(idxs.data(), k, done)) {
+            int64_t terminal = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint32_t idx = idxs[i];
+                Job& j = pool[idx];
+                uint16_t reason;
+                {
+                    PROF_SCOPE(Phase::Service);
+                    start_attempt(j, wrng);
+                    reason = executor->execute(j, wrng);
+                }
+                if (finish_attempt(j, reason, st, &out)) {
+                    again.push_back(idx);
+                } else {
+                    pool.release(idx);
+                    terminal++;
+                }
+            }
+            rec.complete_batch(out);
+            for (uint32_t idx : again) park_retry(idx);
+            again.clear();
+            if (terminal && outstanding.fetch_sub(terminal) == terminal)
+                sched.wake_all(); // last terminal job: release idle workers
+        }
+    }
+
+    // --pin-workers: binds worker thread w to its planned CPU.
+    void place_worker(size_t w) {
+        if (w < worker_cpus.size() && !pin_this_thread(worker_cpus[w])) pin_failures.fetch_add(1);
+    }
+
+    void run_threads(std::vector<WorkerStats>& stats) {
+        retries.start([this](uint32_t idx){
+            requeue(idx, clock.now());
+        });
+        std::thread ingest;
+        if (source) ingest = std::thread([this]{
+            PROF_THREAD("ingest");
+            ingest_loop();
+        });
+        std::vector<std::thread> threads;
+        threads.reserve(stats.size());
+        for (size_t w = 0; w < stats.size(); ++w)
+            threads.emplace_back([this, &stats, w]{
+                PROF_THREAD("worker " + std::to_string(w));
+                place_worker(w);
+                WorkerStats local;      // first touched after pinning
+                worker_loop(local);
+                stats[w] = local;
+            });
+        for (auto& t : threads) t.join();
+        if (ingest.joinable()) ingest.join();
+        retries.stop();
+    }
+
+    // --max-inflight in real time: each of the --workers threads runs an
+    // event loop instead of sleeping through one attempt at a time. An
+    // attempt's service time and a failed job's backoff are both timers on
+    // the loop's own heap, so the number of attempts in flight is bounded by
+    // max_inflight (shared by all loops), not by the number of threads.
+    struct Timer {
+        int64_t due;
+        uint64_t seq;       // FIFO among equal due times
+        uint32_t idx;
+        uint16_t reason;    // completion: outcome sampled at start
+        bool backoff;       // true: retry is due; false: attempt completes
+    };
+    struct TimerLater {
+        bool operator()(Timer const& a, Timer const& b) const {
+            if (a.due != b.due) return a.due > b.due;
+            return a.seq > b.seq;
+        }
+    };
+
+    bool take_slot() {
+        int64_t n = inflight.load();
+        while (n < args.max_inflight) {
+            if (inflight.compare_exchange_weak(n, n + 1)) {
+                int64_t peak = peak_inflight.load();
+                while (n + 1 > peak && !peak_inflight.compare_exchange_weak(peak, n + 1)) {}
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void reactor_loop(WorkerStats& st) {
+        RNG rrng = make_rng();
+        std::priority_queue<Timer, std::vector<Timer>, TimerLater> timers;
+        uint64_t seq = 0;
+        auto done = [this]{ return finished(); };
+        for (;;) {
+            uint32_t idx;
+            while (take_slot()) {
+                if (!sched.try_pop(idx)) {
+                    inflight.fetch_sub(1);
+                    break;
+                }
+                Job& j = pool[idx];
+                int svc;
+                uint16_t reason;
+                {
+                    PROF_SCOPE(Phase::Service);
+                    svc = start_attempt(j, rrng);
+                    reason = SimulatedExecutor::outcome(j, rrng);
+                }
+                timers.push(Timer{clock.now() + svc, seq++, idx, reason, false});
+            }
+
+            int64_t now = clock.now();
+            while (!timers.empty() && timers.top().due <= now) {
+                Timer t = timers.top();
+                timers.pop();
+                if (t.backoff) {
+                    requeue(t.idx, now);
+                    continue;
+                }
+                inflight.fetch_sub(1);
+                Job& j = pool[t.idx];
+                if (finish_attempt(j, t.reason, st)) {
+                    PROF_SCOPE(Phase::Backoff);
+                    timers.push(Timer{now + retry_policy.backoff_ms(j), seq++, t.idx, kReasonNone, true});
+                    continue;
+                }
+                pool.release(t.idx);
+                if (outstanding.fetch_sub(1) == 1) sched.wake_all();
+            }
+            if (timers.empty() && done()) return;
+
+            // Sleep until the next timer. While slots are free, queued work
+            // (or the end of the run) wakes the loop early; while they are
+            // all taken, whichever loop frees one refills it itself.
+            int64_t wait = timers.empty() ? 100 : timers.top().due - clock.now();
+            if (wait <= 0) continue;
+            if (inflight.load() >= args.max_inflight)
+                std::this_thread::sleep_for(Ms(std::min<int64_t>(wait, 5)));
+            else
+                sched.wait_for_work(wait, done);
+        }
+    }
+
+    // --coordinator: the scheduler, retry/aging policy and recorder stay in
+    // this process and remote workers (--connect) execute attempts. Each
+    // connection gets a thread that leases up to --lease-batch jobs per
+    // request and applies Result frames as they stream in. A worker that
+    // sends nothing (not even a heartbeat) for --lease-timeout-ms, or drops
+    // the connection, loses its lease: unfinished jobs go back to the
+    // scheduler at the same attempt.
+    std::atomic<int> remote_workers{0};
+    std::atomic<int> peak_remote_workers{0};
+    std::atomic<uint64_t> lease_expiries{0};
+
+    void requeue_lost(uint32_t idx) {
+        Job& j = pool[idx];
+        if (live) live->in_flight.fetch_sub(1, std::memory_order_relaxed);
+        j.status = JobStatus::Pending;
+        j.start_ts = kNoTs;
+        lease_expiries.fetch_add(1);
+        requeue(idx, clock.now());
+    }
+
+    void serve_worker(socket_t s, WorkerStats& st) {
+        RNG crng = make_rng();
+        std::vector<uint32_t> leased;   // pool indices executing on this worker
+        auto done = [this]{ return finished(); };
+        auto drop_lease = [&]{
+            for (uint32_t idx : leased) requeue_lost(idx);
+            leased.clear();
+        };
+
+        Msg type;
+        std::string in;
+        if (!wait_readable(s, args.lease_timeout_ms) || !recv_frame(s, type, in) ||
+            type != Msg::Hello || WireIn(in).u32() != kProtocolVersion)
+            return;
+        WireOut welcome;
+        welcome.u64(args.seed);
+        welcome.u32((uint32_t)args.mean_ms);
+        welcome.u32((uint32_t)args.stddev_ms);
+        welcome.u32((uint32_t)std::max(1, args.lease_timeout_ms / 3));
+        // The failure model, so remote outcomes match local ones.
+        RNG model = make_rng();
+        welcome.u8((uint8_t)model.fail_steps);
+        for (int a = 0; a < model.fail_steps; ++a) welcome.u64(model.fail_below[a]);
+        int64_t now = clock.now();
+        welcome.u64((uint64_t)(model.spike_from - now));
+        welcome.u64((uint64_t)(model.spike_to - now));
+        welcome.u64(model.spike_below);
+        if (!send_frame(s, Msg::Welcome, welcome.buf)) return;
+
+        int64_t last_seen = clock.now();
+        for (;;) {
+            if (!wait_readable(s, 200)) {
+                if (!leased.empty() && clock.now() - last_seen > args.lease_timeout_ms) {
+                    drop_lease();
+                    return;
+                }
+                if (leased.empty() && done()) {
+                    send_frame(s, Msg::Shutdown);
+                    return;
+                }
+                continue;
+            }
+            if (!recv_frame(s, type, in)) {
+                drop_lease();
+                return;
+            }
+            last_seen = clock.now();
+            WireIn r(in);
+            if (type == Msg::Result) {
+                uint32_t idx = r.u32();
+                uint8_t attempt = r.u8();
+                int32_t svc = (int32_t)r.u32();
+                std::string reason_text = r.bytes(r.u16());
+                auto it = std::find(leased.begin(), leased.end(), idx);
+                if (r.bad || it == leased.end() || pool[idx].attempt != attempt) continue;
+                leased.erase(it);
+                Job& j = pool[idx];
+                // Attempts in a batch run back to back on the worker, so
+                // its start is now minus the measured service time.
+                j.service_ms = std::max(0, (int)svc);
+                j.start_ts = std::max(j.start_ts, clock.now() - j.service_ms);
+                j.wait_ms = (int)(j.start_ts - j.enqueue_ts);
+                uint16_t reason = reason_text.empty() ? (uint16_t)kReasonNone
+                                                      : reasons().intern(reason_text);
+                if (finish_attempt(j, reason, st)) {
+                    park_retry(idx);
+                    continue;
+                }
+                pool.release(idx);
+                if (outstanding.fetch_sub(1) == 1) sched.wake_all();
+            } else if (type == Msg::LeaseReq) {
+                uint32_t want = std::max(1u, std::min(r.u32(), (uint32_t)args.lease_batch));
+                WireOut lease;
+                std::vector<uint32_t> batch;
+                for (;;) {
+                    uint32_t idx;
+                    while (batch.size() < want && sched.try_pop(idx)) batch.push_back(idx);
+                    if (!batch.empty()) break;
+                    if (done()) {
+                        send_frame(s, Msg::Shutdown);
+                        return;
+                    }
+                    sched.wait_for_work(200, done);
+                }
+                lease.u32((uint32_t)batch.size());
+                for (uint32_t idx : batch) {
+                    Job& j = pool[idx];
+                    start_attempt(j, crng);
+                    lease.u32(idx);
+                    lease.u32((uint32_t)j.ext_id);
+                    lease.u16((uint16_t)j.priority);
+                    lease.u8(j.attempt);
+                    lease.u8(j.spec_service_ms > 0 ? 0 : 1);
+                    lease.u32((uint32_t)j.service_ms);
+                    leased.push_back(idx);
+                }
+                if (!send_frame(s, Msg::Lease, lease.buf)) {
+                    drop_lease();
+                    return;
+                }
+            }
+            // Heartbeat: last_seen is all it is for.
+        }
+    }
+
+    void run_coordinator(std::vector<WorkerStats>& stats) {
+        retries.start([this](uint32_t idx){
+            requeue(idx, clock.now());
+        });
+        std::thread ingest;
+        if (source) ingest = std::thread([this]{
+            PROF_THREAD("ingest");
+            ingest_loop();
+        });
+        socket_t listener = listen_on(args.coordinator_port, "--coordinator");
+        std::deque<WorkerStats> conn_stats;     // stable addresses while threads run
+        std::vector<std::thread> conns;
+        while (!finished()) {
+            if (!wait_readable(listener, 200)) continue;
+            socket_t c = accept(listener, nullptr, nullptr);
+            if (c == kNoSocket) continue;
+            int yes = 1;
+            setsockopt(c, IPPROTO_TCP, TCP_NODELAY, (const char*)&yes, sizeof yes);
+            conn_stats.emplace_back();
+            WorkerStats& st = conn_stats.back();
+            int n = remote_workers.fetch_add(1) + 1;
+            peak_remote_workers = std::max(peak_remote_workers.load(), n);
+            size_t id = conns.size();
+            conns.emplace_back([this, c, &st, id]{
+                PROF_THREAD("remote " + std::to_string(id));
+                serve_worker(c, st);
+                close_socket(c);
+                remote_workers.fetch_sub(1);
+            });
+        }
+        close_socket(listener);
+        for (auto& t : conns) t.join();
+        if (ingest.joinable()) ingest.join();
+        retries.stop();
+        for (const WorkerStats& st : conn_stats) stats[0].merge(st);
+    }
+
+    void run_reactor(std::vector<WorkerStats>& stats) {
+        std::thread ingest;
+        if (source) ingest = std::thread([this]{
+            PROF_THREAD("ingest");
+            ingest_loop();
+        });
+        std::vector<std::thread> threads;
+        threads.reserve(stats.size());
+        for (size_t w = 0; w < stats.size(); ++w)
+            threads.emplace_back([this, &stats, w]{
+                PROF_THREAD("reactor " + std::to_string(w));
+                place_worker(w);
+                WorkerStats local;
+                reactor_loop(local);
+                stats[w] = local;
+            });
+        for (auto& t : threads) t.join();
+        if (ingest.joinable()) ingest.join();
+    }
+
+    // Discrete-event simulation of stats.size() workers (or max_inflight
+    // slots) on one thread. Uses the same scheduler, attempt logic and
+    // recorder as run_threads(); only the passage of time is simulated.
+    void run_virtual(std::vector<WorkerStats>& stats) {
+        WorkerStats& st = stats[0];
+        size_t slots = args.max_inflight > 0 ? (size_t)args.max_inflight : stats.size();
+        size_t idle = slots;
+
+        // Only one trace spec is read ahead: it is either behind a pending
+        // Arrival event or, while the ingest window is full, deferred.
+        JobSpec spec;
+        bool deferred = false;
+        auto read_next = [&]{
+            if (source && source->next(spec))
+                push_event(source_t0 + spec.arrival_ms, SimEvent::Arrival, 0);
+            else
+                producing.store(false);
+        };
+        if (source) read_next();
+
+        // --batch: fill idle slots k jobs per scheduler pop and post records
+        // k completions at a time. Everything after a job's first journal
+        // put goes through `out` in order, so one thread needs no extra care.
+        size_t k = (size_t)args.batch;
+        std::vector<uint32_t> idxs(k);
+        RunRecorder::Outbox out;
+        out.reserve(2 * k);
+        for (;;) {
+            if (deferred && !ingest_window_full()) {
+                deferred = false;
+                admit(spec);
+                read_next();
+            }
+            while (idle > 0) {
+                size_t n = sched.pop_batch(idxs.data(), std::min(idle, k));
+                if (!n) break;
+                for (size_t i = 0; i < n; ++i) {
+                    Job& j = pool[idxs[i]];
+                    int svc;
+                    uint16_t reason;
+                    {
+                        PROF_SCOPE(Phase::Service);
+                        svc = start_attempt(j, rng);
+                        reason = SimulatedExecutor::outcome(j, rng);
+                    }
+                    push_event(clock.vnow + svc, SimEvent::Complete, idxs[i], reason);
+                }
+                idle -= n;
+            }
+            peak_inflight = std::max<int64_t>(peak_inflight, (int64_t)(slots - idle));
+            if (events.empty()) break;
+
+            SimEvent ev = events.top();
+            events.pop();
+            clock.vnow = std::max(clock.vnow, ev.t);
+            if (ev.kind == SimEvent::Arrival) {
+                if (ingest_window_full()) {
+                    deferred = true;
+                } else {
+                    admit(spec);
+                    read_next();
+                }
+                continue;
+            }
+            if (ev.kind == SimEvent::RetryDue) {
+                requeue(ev.idx, clock.vnow);
+                continue;
+            }
+            idle++;
+            if (finish_attempt(pool[ev.idx], ev.reason, st, &out)) {
+                park_retry(ev.idx);
+            } else {
+                pool.release(ev.idx);
+                outstanding.fetch_sub(1);
+            }
+            if (out.size() >= k) rec.complete_batch(out);
+        }
+        rec.complete_batch(out);
+    }
+
+    void run() {
+        PROF_THREAD("dispatcher");
+#ifndef DISPATCHER_NO_PROFILE
+        if (!args.trace.empty()) profiler().start_trace();
+#else
+        if (!args.trace.empty())
+            std::cerr << "--trace ignored: built with DISPATCHER_NO_PROFILE\n";
+#endif
+        PhaseTotals phases_before = profiler().snapshot();
+        if (clock.is_virtual) clock.vnow = now_ms();
+        int64_t run_start = clock.now();
+        rec.journal = args.journal || args.resume > 0;
+        source_t0 = run_start;
+        retry_policy.t0 = run_start;
+        configure_rng(rng);
+        auto seed_start = Clock::now();
+        if (args.resume > 0) {
+            rec.resume(args.resume, run_start);
+            int64_t n = restore_queue();
+            if (source) producing.store(true);
+            if (log_level >= LogLevel::Summary)
+                std::cout << "Resuming run " << args.resume << " with "
+                          << n << " journaled jobs\n";
+        } else {
+            rec.begin(run_start, args.seed);
+            if (source) producing.store(true);
+            else seed_jobs();
+        }
+        seed_ms = std::chrono::duration<double, std::milli>(Clock::now() - seed_start).count();
+        if (live)
+            metrics.start(args.metrics_port, [this]{ return render_metrics(); });
+        auto wall_start = Clock::now();
+
+        int nworkers = std::max(1, args.workers);
+        std::vector<WorkerStats> stats(nworkers);
+        if (clock.is_virtual) run_virtual(stats);
+        else if (args.max_inflight > 0) run_reactor(stats);
+        else if (args.coordinator_port > 0) run_coordinator(stats);
+        else run_threads(stats);
+
+        WorkerStats agg;
+        for (auto& st : stats) agg.merge(st);
+        int successes = agg.successes, failures = agg.failures;
+
+        int64_t run_end = clock.now();
+        rec.end(run_end);
+        double wall = std::chrono::duration<double>(Clock::now() - wall_start).count();
+        double seconds = std::max(0.001, clock.is_virtual
+            ? (double)(run_end - run_start) / 1000.0 : wall);
+        int total = successes + failures;
+
+        RunSummary sum;
+        sum.total = total;
+        sum.successes = successes;
+        sum.failures = failures;
+        sum.avg_wait = total ? (double)agg.total_wait / total : 0.0;
+        sum.avg_service = total ? (double)agg.total_service / total : 0.0;
+        sum.avg_turn = total ? (double)agg.total_turn / total : 0.0;
+        sum.throughput = seconds > 0 ? (double)successes / seconds : 0.0;
+        sum.wait = Percentiles::of(agg.wait_h);
+        sum.service = Percentiles::of(agg.service_h);
+        sum.turn = Percentiles::of(agg.turn_h);
+        sum.job = Percentiles::of(agg.job_h);
+        if (int64_t us = first_dispatch_us.load(); us >= 0) sum.first_dispatch_ms = (double)us / 1000.0;
+        sum.denied_retries = (int64_t)(retry_policy.denied_budget.load()
+                                       + retry_policy.denied_breaker.load());
+        sum.policy = sched.policy->name();
+        sum.deadline_misses = agg.deadline_misses;
+        sum.seed = args.seed;
+        sum.executor = executor->name();
+        sum.max_inflight = args.max_inflight;
+        sum.sink = args.sink;
+        sum.rejected = rejected.load();
+        sum.dropped = dropped.load();
+        sum.peak_inflight = peak_inflight.load();
+        int slots = args.max_inflight > 0 ? args.max_inflight
+                  : args.coordinator_port > 0 ? std::max(1, peak_remote_workers.load())
+                  : nworkers;
+        sum.utilization = (double)agg.busy_ms / (seconds * 1000.0 * slots);
+        summary = sum;
+
+        rec.record_run_summary(sum);
+        metrics.stop();
+        logger().sync();
+        PhaseTotals phases = profiler().snapshot();
+        phases.add(phases_before, -1);
+#ifndef DISPATCHER_NO_PROFILE
+        if (!args.trace.empty() && !profiler().write_trace(args.trace))
+            std::cerr << "Failed to write trace file: " << args.trace << "\n";
+#endif
+        if (log_level < LogLevel::Summary) return;
+
+        auto pct_line = [](const Percentiles& p){
+            std::ostringstream o;
+            o << std::fixed << std::setprecision(0)
+              << p.p50 << " / " << p.p90 << " / " << p.p99 << " / " << p.p999 << " ms";
+            return o.str();
+        };
+        std::cout << "\n=== RUN SUMMARY ===\n"
+                  << "Workers:    " << nworkers << "\n"
+                  << "Policy:     " << sum.policy << " (" << sum.deadline_misses
+                  << " deadline misses)\n"
+                  << "Executor:   " << sum.executor << "\n"
+                  << "Total jobs: " << total << "\n"
+                  << "Success:    " << successes << "\n"
+                  << "Failed:     " << failures << "\n";
+        if (args.resume > 0) {
+            RunRecorder::RunTotals t;
+            rec.load_run(args.resume, t);
+            std::cout << "Run total:  " << t.total << " jobs (" << t.successes << " success, "
+                      << t.failures << " failed) in run " << args.resume << "\n";
+        }
+        std::cout << "Avg Wait:   " << std::fixed << std::setprecision(2) << sum.avg_wait << " ms\n"
+                  << "Avg Service:" << sum.avg_service << " ms\n"
+                  << "Avg Turn:   " << sum.avg_turn << " ms\n"
+                  << "Throughput: " << sum.throughput << " jobs/s";
+        if (sum.max_inflight > 0)
+            std::cout << " (max in-flight " << sum.max_inflight << ", peak "
+                      << sum.peak_inflight << ")";
+        std::cout << "\n"
+                  << "Utilization:" << sum.utilization * 100.0 << " %\n";
+        if (args.max_queue > 0)
+            std::cout << "Overload:   " << args.overload << " at " << args.max_queue
+                      << " queued (" << sum.rejected << " rejected, " << sum.dropped
+                      << " dropped)\n";
+        if (!worker_cpus.empty()) {
+            std::cout << "Pinning:    " << args.pin_workers << ", " << worker_cpus.size()
+                      << " workers on " << topology.cpus() << " CPUs in "
+                      << topology.nodes.size() << " NUMA node(s)";
+            if (int n = pin_failures.load()) std::cout << " (" << n << " could not be pinned)";
+            std::cout << "\n";
+        }
+        if (dedup.mode != DedupIndex::Mode::Off)
+            std::cout << "Dedup:      " << DedupIndex::mode_str(dedup.mode) << " ("
+                      << dedup.merged.load() << " merged, " << dedup.raised.load()
+                      << " raised in queue, " << dedup.rejected.load() << " rejected)\n";
+        std::cout << "Per attempt  p50 / p90 / p99 / p99.9\n"
+                  << "  Wait:     " << pct_line(sum.wait) << "\n"
+                  << "  Service:  " << pct_line(sum.service) << "\n"
+                  << "  Turn:     " << pct_line(sum.turn) << "\n"
+                  << "Per successful job, first enqueue to success\n"
+                  << "  Job:      " << pct_line(sum.job) << "\n"
+                  << std::setprecision(2);
+        if (retry_policy.jitter != RetryPolicy::Jitter::None || retry_policy.windowed())
+            std::cout << "Retries:    " << retry_policy.retried.load() << " retried, "
+                      << retry_policy.denied_budget.load() << " denied by budget, "
+                      << retry_policy.denied_breaker.load() << " denied by breaker ("
+                      << retry_policy.breaker_opens.load() << " opens), jitter "
+                      << RetryPolicy::jitter_str(retry_policy.jitter) << "\n";
+#ifndef DISPATCHER_NO_PROFILE
+        // Self time summed over threads; real-mode service is worker sleep.
+        double ms_per_tick = profiler().ns_per_tick() / 1e6;
+        std::cout << "Time by phase (all threads)\n";
+        for (int p = 0; p < kPhases; ++p) {
+            std::string label = std::string(phase_str((Phase)p)) + ":";
+            std::cout << "  " << std::left << std::setw(10) << label << std::right
+                      << std::setw(12) << (double)phases.ticks[p] * ms_per_tick << " ms  ("
+                      << phases.calls[p] << " scopes)\n";
+        }
+        std::cout << std::left;
+        if (!args.trace.empty())
+            std::cout << "Trace:      " << args.trace << "\n";
+#endif
+        if (sum.first_dispatch_ms >= 0)
+            std::cout << "Startup:    " << sum.first_dispatch_ms << " ms to first dispatch ("
+                      << seed_ms << " ms seeding)\n";
+        if (args.arrival_rate > 0 && source && args.input.empty())
+            std::cout << "Arrivals:   " << args.arrival_dist << " @ "
+                      << args.arrival_rate << " jobs/s\n";
+        if (clock.is_virtual)
+            std::cout << "Clock:      virtual (" << seconds << " s simulated in "
+                      << wall << " s wall)\n";
+        if (args.coordinator_port > 0)
+            std::cout << "Remote:     up to " << peak_remote_workers.load()
+                      << " workers, " << lease_expiries.load() << " leased attempts re-enqueued\n";
+        if (uint64_t n = logger().suppressed.load())
+            std::cout << "Log:        " << n << " job lines dropped by --log-rate\n";
+
+        if (recent_failures.cap > 0) {
+            std::vector<Job> last = recent_failures.snapshot();
+            std::cout << "\n=== LAST " << last.size() << " OF "
+                      << recent_failures.pushed << " FAILURES ===\n";
+            std::string line;
+            for (const Job& f : last) {
+                line.clear();
+                append_job_line(line, f);
+                std::cout << line;
+            }
+        }
+        std::cout.flush();
+    }
+
+    // Prometheus text exposition for the metrics thread. Reads atomics only.
+    std::string render_metrics() const {
+        std::string out;
+        char line[320];
+        auto metric = [&](const char* name, const char* type, const char* help, double v){
+            std::snprintf(line, sizeof line, "# HELP %s %s\n# TYPE %s %s\n%s %.17g\n",
+                          name, help, name, type, name, v);
+            out += line;
+        };
+        auto ld = [](const std::atomic<uint64_t>& c){
+            return (double)c.load(std::memory_order_relaxed);
+        };
+        metric("dispatcher_queue_depth", "gauge", "Jobs waiting in the scheduler.",
+               (double)sched.size());
+        metric("dispatcher_in_flight", "gauge", "Attempts currently running.",
+               (double)live->in_flight.load(std::memory_order_relaxed));
+        metric("dispatcher_outstanding_jobs", "gauge",
+               "Jobs admitted but not yet terminal (queued, running or in backoff).",
+               (double)outstanding.load());
+        metric("dispatcher_attempts_total", "counter", "Attempts started.", ld(live->attempts));
+        metric("dispatcher_jobs_succeeded_total", "counter", "Jobs finished successfully.",
+               ld(live->successes));
+        metric("dispatcher_jobs_failed_total", "counter", "Jobs failed after their last retry.",
+               ld(live->failures));
+        metric("dispatcher_retries_total", "counter", "Failed attempts that were retried.",
+               ld(live->retries));
+        metric("dispatcher_jobs_rejected_total", "counter", "Jobs turned away by --max-queue.",
+               ld(live->rejected));
+        metric("dispatcher_jobs_dropped_total", "counter", "Jobs shed from a full queue.",
+               ld(live->dropped));
+        if (int64_t us = first_dispatch_us.load(); us >= 0)
+            metric("dispatcher_first_dispatch_ms", "gauge",
+                   "Wall time from startup to the first attempt, ms.", (double)us / 1000.0);
+        live->wait.render(out, "dispatcher_wait_ms", "Queue wait per attempt, ms.");
+        live->turnaround.render(out, "dispatcher_turnaround_ms", "Enqueue to completion per attempt, ms.");
+        return out;
+    }
+
+    static void append_job_line(std::string& out, const Job& j) {
+        char tmp[160];
+        int n = std::snprintf(tmp, sizeof tmp,
+            "[Job %d | prio=%d | att=%d] wait=%dms, service=%dms, turn=%dms -> %s",
+            j.ext_id, (int)j.priority, (int)j.attempt, j.wait_ms, j.service_ms,
+            j.turnaround_ms, status_str(j.status));
+        out.append(tmp, (size_t)std::max(0, std::min(n, (int)sizeof tmp - 1)));
+        if (j.fail_reason != kReasonNone)
+            out.append(" (").append(reasons().name(j.fail_reason)).append(")");
+        out.push_back('\n');
+    }
+
+    void log_console(const Job& j) {
+        if (log_level < LogLevel::Job || !logger().admit_job_line()) return;
+        PROF_SCOPE(Phase::Log);
+        std::string& buf = logger().local();
+        append_job_line(buf, j);
+        logger().commit(buf);
+    }
+};
+
+// --------------------------- Remote worker ---------------------------
+// --connect host:port: executes attempts leased from a --coordinator with
+// this process's --executor. Each of the --workers threads holds one
+// connection, runs its leased batch in order and streams back one Result
+// per attempt; a shared thread sends heartbeats on every connection so long
+// attempts keep their lease. Sampled draws use the coordinator's seed and
+// the same per-attempt streams as a local run.
+struct RemoteWorker {
+    struct Conn {
+        socket_t s = kNoSocket;
+        std::mutex write_mu;    // worker thread and heartbeat thread both send
+        bool send(Msg type, const std::string& payload = std::string()) {
+            std::lock_guard<std::mutex> lk(write_mu);
+            return send_frame(s, type, payload);
+        }
+    };
+
+    Args args;
+    std::unique_ptr<Executor> executor;
+    std::vector<std::unique_ptr<Conn>> conns;
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> attempts{0};
+    std::atomic<int> heartbeat_ms{1000};
+
+    explicit RemoteWorker(const Args& a)
+      : args(a), executor(make_executor(a.executor, a.command)) {}
+
+    void conn_loop(Conn& c) {
+        WireOut hello;
+        hello.u32(kProtocolVersion);
+        Msg type;
+        std::string in;
+        if (!c.send(Msg::Hello, hello.buf) || !recv_frame(c.s, type, in) || type != Msg::Welcome) {
+            std::cerr << "--connect: handshake with " << args.connect << " failed\n";
+            return;
+        }
+        WireIn w(in);
+        uint64_t seed = w.u64();
+        int mean = (int)w.u32(), stddev = (int)w.u32();
+        heartbeat_ms = (int)w.u32();
+        RNG r(mean, stddev, seed);
+        r.fail_steps = std::max(1, std::min<int>(w.u8(), RNG::kMaxFailSteps));
+        for (int a = 0; a < r.fail_steps; ++a) r.fail_below[a] = w.u64();
+        int64_t now = now_ms();
+        r.spike_from = now + (int64_t)w.u64();
+        r.spike_to = now + (int64_t)w.u64();
+        r.spike_below = w.u64();
+        if (w.bad) {
+            std::cerr << "--connect: malformed welcome from " << args.connect << "\n";
+            return;
+        }
+
+        WireOut req;
+        req.u32((uint32_t)std::max(1, args.lease_batch));
+        while (c.send(Msg::LeaseReq, req.buf) && recv_frame(c.s, type, in) && type == Msg::Lease) {
+            WireIn lease(in);
+            uint32_t n = lease.u32();
+            for (uint32_t i = 0; i < n && !lease.bad; ++i) {
+                uint32_t idx = lease.u32();
+                Job j;
+                j.ext_id = (int32_t)lease.u32();
+                j.priority = (int16_t)lease.u16();
+                j.attempt = lease.u8();
+                bool sampled = lease.u8() != 0;
+                j.service_ms = (int32_t)lease.u32();
+                // Same stream position as Dispatcher::start_attempt leaves.
+                r.begin(j.ext_id, j.attempt);
+                if (sampled) r.service_ms();
+                j.start_ts = now_ms();
+                uint16_t reason;
+                {
+                    PROF_SCOPE(Phase::Service);
+                    reason = executor->execute(j, r);
+                }
+                attempts.fetch_add(1);
+                WireOut res;
+                res.u32(idx);
+                res.u8(j.attempt);
+                res.u32((uint32_t)j.service_ms);
+                const std::string& text = reasons().name(reason);
+                res.u16((uint16_t)std::min<size_t>(text.size(), 1024));
+                res.bytes(text.substr(0, 1024));
+                if (!c.send(Msg::Result, res.buf)) return;
+            }
+        }
+    }
+
+    int run() {
+        for (int i = 0; i < std::max(1, args.workers); ++i) {
+            std::unique_ptr<Conn> c(new Conn());
+            c->s = connect_to(args.connect);
+            if (c->s == kNoSocket) {
+                std::cerr << "--connect: cannot reach " << args.connect << "\n";
+                return 1;
+            }
+            conns.push_back(std::move(c));
+        }
+        std::thread heartbeat([this]{
+            PROF_THREAD("heartbeat");
+            while (!stopping) {
+                std::this_thread::sleep_for(Ms(heartbeat_ms.load()));
+                for (auto& c : conns) c->send(Msg::Heartbeat);
+            }
+        });
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < conns.size(); ++i)
+            threads.emplace_back([this, i]{
+                PROF_THREAD("remote-worker " + std::to_string(i));
+                conn_loop(*conns[i]);
+            });
+        for (auto& t : threads) t.join();
+        stopping = true;
+        heartbeat.join();
+        for (auto& c : conns) close_socket(c->s);
+        std::cout << "Executed " << attempts.load() << " attempts for " << args.connect << "\n";
+        return 0;
+    }
+};
+
+// --------------------------- Sweep ---------------------------
+// --sweep sweep.json: a parameter grid over the Args below, e.g.
+//   {"jobs": [1000, 10000], "mean_ms": [100, 300], "max_retries": 2,
+//    "policy": ["strict", "edf"]}
+// A scalar is a one-point axis. Every combination runs as its own
+// --virtual-clock Dispatcher (own RNG, scheduler and recorder, job rows
+// off) on a pool of --sweep-threads; one writer thread stores a row per
+// scenario in sweep_results. Scenarios share the seed unless "seed" is an
+// axis, so they see the same random draws and differ only by parameters.
+struct SweepAxis {
+    std::string key;
+    std::vector<std::string> values;
+    std::vector<std::string> json;  // values as written, for sweep_results.params
+};
+
+// Sets one sweepable field from its sweep.json key; false if unknown.
+bool set_sweep_param(Args& a, const std::string& key, const std::string& v) {
+    if (key == "jobs") a.jobs = std::stoi(v);
+    else if (key == "mean_ms") a.mean_ms = std::stoi(v);
+    else if (key == "stddev_ms") a.stddev_ms = std::stoi(v);
+    else if (key == "max_retries") a.max_retries = std::stoi(v);
+    else if (key == "workers") a.workers = std::stoi(v);
+    else if (key == "max_inflight") a.max_inflight = std::stoi(v);
+    else if (key == "batch") a.batch = std::stoi(v);
+    else if (key == "policy") a.policy = v;
+    else if (key == "deadline_ms") a.deadline_ms = std::stoi(v);
+    else if (key == "mlfq_boost_ms") a.mlfq_boost_ms = std::stoi(v);
+    else if (key == "arrival_rate") a.arrival_rate = std::stod(v);
+    else if (key == "arrival_dist") a.arrival_dist = v;
+    else if (key == "burst_on_ms") a.burst_on_ms = std::stoi(v);
+    else if (key == "burst_off_ms") a.burst_off_ms = std::stoi(v);
+    else if (key == "seed") a.seed = std::stoull(v);
+    else if (key == "max_queue") a.max_queue = std::stoi(v);
+    else if (key == "overload") a.overload = v;
+    else if (key == "jitter") a.jitter = v;
+    else if (key == "backoff_base_ms") a.backoff_base_ms = std::stoi(v);
+    else if (key == "backoff_cap_ms") a.backoff_cap_ms = std::stoi(v);
+    else if (key == "retry_budget") a.retry_budget = std::stod(v);
+    else if (key == "breaker_threshold") a.breaker_threshold = std::stod(v);
+    else if (key == "breaker_window_ms") a.breaker_window_ms = std::stoi(v);
+    else if (key == "breaker_open_ms") a.breaker_open_ms = std::stoi(v);
+    else if (key == "fail_probs") a.fail_probs = v;
+    else if (key == "fail_spike") a.fail_spike = v;
+    else if (key == "dedup") a.dedup = v;
+    else return false;
+    return true;
+}
+
+// Reads the flat object of sweep.json: string or number values, or arrays
+// of them. Errors are fatal, like bad command-line values.
+struct SweepParser {
+    std::string path;
+    std::string s;
+    size_t p = 0;
+
+    [[noreturn]] void fail(const char* what) {
+        std::cerr << path << ": " << what << " at offset " << p << "\n";
+        std::exit(1);
+    }
+    void ws() { while (p < s.size() && std::isspace((unsigned char)s[p])) ++p; }
+    bool eat(char c) {
+        ws();
+        if (p < s.size() && s[p] == c) { ++p; return true; }
+        return false;
+    }
+    void expect(char c) {
+        if (!eat(c)) fail((std::string("expected '") + c + "'").c_str());
+    }
+    std::string string_token() {
+        expect('"');
+        std::string out;
+        while (p < s.size() && s[p] != '"') {
+            if (s[p] == '\\' && p + 1 < s.size()) ++p;
+            out += s[p++];
+        }
+        expect('"');
+        return out;
+    }
+    std::string scalar() {
+        ws();
+        if (p < s.size() && s[p] == '"') return string_token();
+        size_t b = p;
+        while (p < s.size() && (std::isalnum((unsigned char)s[p]) || std::strchr("+-.", s[p]))) ++p;
+        if (p == b) fail("expected a value");
+        return s.substr(b, p - b);
+    }
+
+    std::vector<SweepAxis> parse() {
+        std::vector<SweepAxis> axes;
+        expect('{');
+        if (eat('}')) return axes;
+        do {
+            SweepAxis ax;
+            ax.key = string_token();
+            expect(':');
+            auto value = [&]{
+                ws();
+                size_t b = p;
+                ax.values.push_back(scalar());
+                ax.json.push_back(s.substr(b, p - b));
+            };
+            if (eat('[')) {
+                if (!eat(']')) {
+                    do value(); while (eat(','));
+                    expect(']');
+                }
+            } else {
+                value();
+            }
+            if (ax.values.empty()) fail("empty axis");
+            axes.push_back(std::move(ax));
+        } while (eat(','));
+        expect('}');
+        return axes;
+    }
+};
+
+std::vector<SweepAxis> load_sweep(const std::string& path) {
+    std::ifstream f(path);
+    if (!f) {
+        std::cerr << "Failed to open sweep file: " << path << "\n";
+        std::exit(1);
+    }
+    std::ostringstream buf;
+    buf << f.rdbuf();
+    SweepParser parser{path, buf.str()};
+    std::vector<SweepAxis> axes = parser.parse();
+    Args probe;
+    for (const auto& ax : axes)
+        for (const auto& v : ax.values) {
+            bool known;
+            try {
+                known = set_sweep_param(probe, ax.key, v);
+            } catch (const std::exception&) {
+                std::cerr << path << ": bad value for " << ax.key << ": " << v << "\n";
+                std::exit(1);
+            }
+            if (!known) {
+                std::cerr << path << ": unknown sweep parameter: " << ax.key << "\n";
+                std::exit(1);
+            }
+        }
+    return axes;
+}
+
+struct SweepResult {
+    int scenario = 0;
+    std::string params;         // this point of the grid as a JSON object
+    Args args;
+    RunSummary sum;
+    double wall_ms = 0;
+};
+
+// The one SQLite writer of a sweep: scenario threads post results and a
+// single thread inserts whatever has queued up in one transaction, the same
+// hand-off RunRecorder uses for job rows.
+struct SweepWriter {
+    DB& db;
+    sqlite3_stmt* ins = nullptr;
+    int sweep_id = 0;
+
+    std::mutex mu;
+    std::condition_variable cv;
+    std::vector<SweepResult> pending;
+    bool stopping = false;
+    std::thread writer;
+
+    explicit SweepWriter(DB& d) : db(d) {
+        sqlite3_stmt* st = nullptr;
+        if (sqlite3_prepare_v2(db.db, "SELECT COALESCE(MAX(sweep_id),0)+1 FROM sweep_results;",
+                               -1, &st, nullptr) != SQLITE_OK)
+            die("prepare sweep_id");
+        if (sqlite3_step(st) == SQLITE_ROW) sweep_id = sqlite3_column_int(st, 0);
+        sqlite3_finalize(st);
+
+        const char* sql =
+          "INSERT INTO sweep_results(sweep_id,scenario,params,jobs,mean_ms,stddev_ms,"
+          "max_retries,workers,policy,seed,total_jobs,success_jobs,failed_jobs,"
+          "avg_wait_ms,avg_turnaround_ms,throughput_jobs_per_s,utilization,"
+          "wait_p99_ms,turnaround_p99_ms,deadline_misses,wall_ms,rejected_jobs,dropped_jobs,"
+          "job_p99_ms,denied_retries)"
+          " VALUES(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?);";
+        if (sqlite3_prepare_v2(db.db, sql, -1, &ins, nullptr) != SQLITE_OK) die("prepare sweep_results");
+        writer = std::thread([this]{
+            PROF_THREAD("sweep-writer");
+            loop();
+        });
+    }
+    ~SweepWriter() {
+        stop();
+        if (ins) sqlite3_finalize(ins);
+    }
+    [[noreturn]] void die(const char* where) {
+        std::cerr << where << " : " << sqlite3_errmsg(db.db) << "\n";
+        std::exit(1);
+    }
+
+    void post(SweepResult r) {
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            pending.push_back(std::move(r));
+        }
+        cv.notify_one();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            stopping = true;
+        }
+        cv.notify_one();
+        if (writer.joinable()) writer.join();
+    }
+
+    void loop() {
+        std::vector<SweepResult> batch;
+        std::unique_lock<std::mutex> lk(mu);
+        for (;;) {
+            cv.wait(lk, [&]{ return stopping || !pending.empty(); });
+            bool last = stopping;
+            batch.swap(pending);
+            lk.unlock();
+            if (!batch.empty()) write(batch);
+            batch.clear();
+            lk.lock();
+            if (last && pending.empty()) return;
+        }
+    }
+
+    void write(const std::vector<SweepResult>& rows) {
+        PROF_SCOPE(Phase::Db);
+        db.exec("BEGIN;");
+        for (const auto& r : rows) {
+            const Args& a = r.args;
+            const RunSummary& m = r.sum;
+            int i = 1;
+            bool ok = sqlite3_bind_int(ins, i++, sweep_id) == SQLITE_OK
+                && sqlite3_bind_int(ins, i++, r.scenario) == SQLITE_OK
+                && sqlite3_bind_text(ins, i++, r.params.c_str(), -1, SQLITE_TRANSIENT) == SQLITE_OK
+                && sqlite3_bind_int(ins, i++, a.jobs) == SQLITE_OK
+                && sqlite3_bind_int(ins, i++, a.mean_ms) == SQLITE_OK
+                && sqlite3_bind_int(ins, i++, a.stddev_ms) == SQLITE_OK
+                && sqlite3_bind_int(ins, i++, a.max_retries) == SQLITE_OK
+                && sqlite3_bind_int(ins, i++, a.workers) == SQLITE_OK
+                && sqlite3_bind_text(ins, i++, m.policy.c_str(), -1, SQLITE_TRANSIENT) == SQLITE_OK
+                && sqlite3_bind_int64(ins, i++, (sqlite3_int64)m.seed) == SQLITE_OK
+                && sqlite3_bind_int(ins, i++, m.total) == SQLITE_OK
+                && sqlite3_bind_int(ins, i++, m.successes) == SQLITE_OK
+                && sqlite3_bind_int(ins, i++, m.failures) == SQLITE_OK
+                && sqlite3_bind_double(ins, i++, m.avg_wait) == SQLITE_OK
+                && sqlite3_bind_double(ins, i++, m.avg_turn) == SQLITE_OK
+                && sqlite3_bind_double(ins, i++, m.throughput) == SQLITE_OK
+                && sqlite3_bind_double(ins, i++, m.utilization) == SQLITE_OK
+                && sqlite3_bind_double(ins, i++, m.wait.p99) == SQLITE_OK
+                && sqlite3_bind_double(ins, i++, m.turn.p99) == SQLITE_OK
+                && sqlite3_bind_int(ins, i++, m.deadline_misses) == SQLITE_OK
+                && sqlite3_bind_double(ins, i++, r.wall_ms) == SQLITE_OK
+                && sqlite3_bind_int64(ins, i++, m.rejected) == SQLITE_OK
+                && sqlite3_bind_int64(ins, i++, m.dropped) == SQLITE_OK
+                && sqlite3_bind_double(ins, i++, m.job.p99) == SQLITE_OK
+                && sqlite3_bind_int64(ins, i++, m.denied_retries) == SQLITE_OK;
+            if (!ok) die("bind sweep_results");
+            if (sqlite3_step(ins) != SQLITE_DONE) die("step sweep_results");
+            sqlite3_reset(ins);
+            sqlite3_clear_bindings(ins);
+        }
+        db.exec("COMMIT;");
+    }
+};
+
+int run_sweep(const Args& base) {
+    std::vector<SweepAxis> axes = load_sweep(base.sweep);
+    int64_t points = 1;
+    for (const auto& ax : axes) {
+        points *= (int64_t)ax.values.size();
+        if (points > 1000000) {
+            std::cerr << base.sweep << ": grid has more than 1000000 scenarios\n";
+            std::exit(1);
+        }
+    }
+    int nthreads = base.sweep_threads > 0 ? base.sweep_threads
+                 : std::max(1, (int)std::thread::hardware_concurrency());
+    nthreads = (int)std::min<int64_t>(nthreads, points);
+    LogLevel level = parse_log_level(base.log_level);
+
+    // Scenario n: the base flags, then grid point n (mixed radix, last axis
+    // fastest), then the settings every sweep scenario runs with.
+    Args common = Dispatcher::with_seed(base);
+    auto scenario = [&](int64_t n) {
+        SweepResult r;
+        r.scenario = (int)n;
+        r.args = common;
+        std::vector<size_t> digit(axes.size());
+        for (size_t i = axes.size(); i-- > 0;) {
+            digit[i] = (size_t)(n % (int64_t)axes[i].values.size());
+            n /= (int64_t)axes[i].values.size();
+        }
+        r.params = "{";
+        for (size_t i = 0; i < axes.size(); ++i) {
+            set_sweep_param(r.args, axes[i].key, axes[i].values[digit[i]]);
+            if (i) r.params += ",";
+            r.params += "\"" + axes[i].key + "\":" + axes[i].json[digit[i]];
+        }
+        r.params += "}";
+        Args& a = r.args;
+        a.virtual_clock = true;
+        a.log_level = "quiet";
+        a.db = ":memory:";
+        a.job_rows = false;
+        a.sink = "sqlite";
+        a.journal = false;
+        a.resume = 0;
+        a.input.clear();
+        a.trace.clear();
+        a.metrics_port = 0;
+        a.executor = "sim";
+        a.coordinator_port = 0;
+        return r;
+    };
+
+    DB db(base.db);
+    SweepWriter out(db);
+    if (level >= LogLevel::Summary)
+        std::cout << "Sweep " << out.sweep_id << ": " << points << " scenarios from "
+                  << base.sweep << " on " << nthreads << " threads, seed=" << common.seed
+                  << ", db=" << base.db << "\n" << std::flush;
+
+    std::vector<SweepResult> results((size_t)points);
+    std::atomic<int64_t> next{0};
+    auto t0 = Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; ++t)
+        threads.emplace_back([&, t]{
+            PROF_THREAD("sweep " + std::to_string(t));
+            for (int64_t n; (n = next.fetch_add(1)) < points;) {
+                SweepResult r = scenario(n);
+                auto s0 = Clock::now();
+                {
+                    Dispatcher d(r.args);
+                    d.run();
+                    r.sum = d.summary;
+                }
+                r.wall_ms = std::chrono::duration<double, std::milli>(Clock::now() - s0).count();
+                results[(size_t)n] = r;
+                out.post(std::move(r));
+            }
+        });
+    for (auto& t : threads) t.join();
+    out.stop();
+    double wall = std::chrono::duration<double>(Clock::now() - t0).count();
+    if (level < LogLevel::Summary) return 0;
+
+    std::cout << "\n=== SWEEP " << out.sweep_id << " (" << points << " scenarios, "
+              << std::fixed << std::setprecision(2) << wall << " s) ===\n"
+              << std::left << std::setw(6) << "#" << std::setw(10) << "ok"
+              << std::setw(8) << "failed" << std::setw(12) << "jobs/s"
+              << std::setw(10) << "util %" << std::setw(12) << "wait p99"
+              << std::setw(12) << "turn p99" << std::setw(12) << "job p99" << "params\n";
+    for (const auto& r : results) {
+        const RunSummary& m = r.sum;
+        std::cout << std::setw(6) << r.scenario << std::setw(10) << m.successes
+                  << std::setw(8) << m.failures << std::setprecision(2)
+                  << std::setw(12) << m.throughput << std::setprecision(1)
+                  << std::setw(10) << m.utilization * 100.0 << std::setprecision(0)
+                  << std::setw(12) << m.wait.p99 << std::setw(12) << m.turn.p99
+                  << std::setw(12) << m.job.p99 << r.params << "\n";
+    }
+    std::cout << "Results:    sweep_results WHERE sweep_id=" << out.sweep_id << "\n";
+    return 0;
+}
+
+// --------------------------- main ---------------------------
+#ifndef DISPATCHER_NO_MAIN
+int main(int argc, char** argv) {
+    Args parsed = parse_args(argc, argv);
+    if (!parsed.connect.empty()) return RemoteWorker(parsed).run();
+    if (!parsed.sweep.empty()) return run_sweep(parsed);
+    Dispatcher d(parsed);
+    const Args& args = d.args;
+
+    if (d.log_level >= LogLevel::Summary) {
+        std::cout << "Dispatcher starting with ";
+        if (args.resume > 0)
+            std::cout << "run " << args.resume << " resumed ("
+                      << d.resumed.total + d.resumed.queued << " jobs: " << d.resumed.total
+                      << " done, " << d.resumed.queued << " journaled)";
+        else if (args.input.empty()) std::cout << args.jobs << " jobs";
+        else std::cout << "input=" << args.input;
+        std::cout << ", max_retries=" << args.max_retries
+                  << ", mean=" << args.mean_ms << "ms, stddev=" << args.stddev_ms
+                  << "ms, workers=" << args.workers
+                  << ", policy=" << args.policy
+                  << ", executor=" << args.executor
+                  << (args.sink != "sqlite" ? ", sink=" + args.sink : "")
+                  << ", db_batch=" << args.db_batch
+                  << (args.batch > 1 ? ", batch=" + std::to_string(args.batch) : "")
+                  << ", seed=" << args.seed
+                  << (args.virtual_clock ? ", clock=virtual" : "")
+                  << (args.coordinator_port > 0
+                          ? ", coordinator=:" + std::to_string(args.coordinator_port) : "")
+                  << ", db=" << args.db << "\n" << std::flush;
+    }
 
-    Dispatcher d(args);
     d.run();
     return 0;
 }
+#endif // DISPATCHER_NO_MAIN
@@ -0,0 +1,820 @@
+// Micro-benchmarks for the dispatcher hot paths.
+//
+// Build (Linux):
+//   g++ -std=c++17 -O2 -pthread dispatcher_bench.cpp -lsqlite3 -o dispatcher_bench
+// Run all, or only the cases whose name contains FILTER:
+//   ./dispatcher_bench [FILTER]      ./dispatcher_bench --list
+#define DISPATCHER_NO_MAIN
+#include "dispatcher.cpp"
+
+#include <new>
+#include <optional>
+
+// --------------------------- Harness ---------------------------
+// Results are folded into this so the optimizer cannot drop measured work.
+volatile int64_t g_sink = 0;
+
+// Counting allocator: every global operator new in the process bumps this.
+std::atomic<uint64_t> g_allocs{0};
+
+void* counted_alloc(std::size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* counted_alloc(std::size_t n, std::align_val_t al) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    std::size_t a = (std::size_t)al;
+    if (void* p = std::aligned_alloc(a, (n + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t n) { return counted_alloc(n); }
+void* operator new[](std::size_t n) { return counted_alloc(n); }
+void* operator new(std::size_t n, std::align_val_t al) { return counted_alloc(n, al); }
+void* operator new[](std::size_t n, std::align_val_t al) { return counted_alloc(n, al); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+double seconds_since(Clock::time_point t0) {
+    return std::max(1e-9, std::chrono::duration<double>(Clock::now() - t0).count());
+}
+
+// Scratch SQLite file in the working directory, removed with its WAL files.
+struct ScratchDb {
+    std::string path;
+    explicit ScratchDb(const std::string& p) : path(p) { remove(); }
+    ~ScratchDb() { remove(); }
+    void remove() {
+        for (const char* suffix : {"", "-wal", "-shm"}) std::remove((path + suffix).c_str());
+    }
+};
+
+// Baseline: the single mutex-guarded heap Dispatcher used before Scheduler.
+struct LockedHeap {
+    std::mutex mu;
+    std::priority_queue<Job, std::vector<Job>, JobCmp> pq;
+
+    void push(const Job& j) {
+        std::lock_guard<std::mutex> lk(mu);
+        pq.push(j);
+    }
+    bool try_pop(Job& out) {
+        std::lock_guard<std::mutex> lk(mu);
+        if (pq.empty()) return false;
+        out = pq.top();
+        pq.pop();
+        return true;
+    }
+};
+
+// Scheduler plus the pool it indexes, driven like a by-value queue: push
+// copies the job into a pool slot, pop copies it out and frees the slot.
+struct PooledScheduler {
+    JobPool pool;
+    Scheduler sched{pool};
+
+    void push(const Job& j) {
+        uint32_t idx = pool.acquire();
+        pool[idx] = j;
+        sched.push(idx);
+    }
+    bool try_pop(Job& out) {
+        uint32_t idx;
+        if (!sched.try_pop(idx)) return false;
+        out = pool[idx];
+        pool.release(idx);
+        return true;
+    }
+};
+
+// Pops one job and pushes it straight back with a later enqueue_ts, the
+// way a retry re-enters the queue.
+bool requeue(LockedHeap& q, int depth) {
+    Job j;
+    if (!q.try_pop(j)) return false;
+    j.enqueue_ts += depth;
+    q.push(j);
+    return true;
+}
+
+bool requeue(PooledScheduler& q, int depth) {
+    uint32_t idx;
+    if (!q.sched.try_pop(idx)) return false;
+    q.pool[idx].enqueue_ts += depth;
+    q.sched.push(idx);
+    return true;
+}
+
+Job bench_job(int id, RNG& rng) {
+    Job j;
+    j.ext_id = id;
+    j.priority = (int16_t)rng.priority();
+    j.max_retries = 2;
+    j.enqueue_ts = id;
+    return j;
+}
+
+// Each thread pops a job and pushes it straight back (like a retry), so the
+// queue stays at `depth` while every operation contends on the structure.
+template <class Q>
+double contention_pops_per_s(int threads, int depth, int ops_per_thread) {
+    Q q;
+    RNG rng(300, 100, 1);
+    for (int i = 0; i < depth; ++i) q.push(bench_job(i, rng));
+
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&]{
+            ready.fetch_add(1);
+            while (!go.load()) std::this_thread::yield();
+            for (int i = 0; i < ops_per_thread; ++i) requeue(q, depth);
+        });
+    }
+    while (ready.load() < threads) std::this_thread::yield();
+    auto t0 = Clock::now();
+    go.store(true);
+    for (auto& th : pool) th.join();
+    return (double)threads * ops_per_thread / seconds_since(t0);
+}
+
+void bench_scheduler_contention() {
+    const int depth = 10000;
+    const int ops = 200000;
+    std::cout << "== scheduler contention (depth=" << depth
+              << ", pop+push per op) ==\n"
+              << std::left << std::setw(10) << "workers"
+              << std::setw(18) << "LockedHeap pops/s"
+              << std::setw(18) << "Scheduler pops/s" << "\n";
+    for (int w : {1, 2, 4, 8, 16}) {
+        double base = contention_pops_per_s<LockedHeap>(w, depth, ops);
+        double shard = contention_pops_per_s<PooledScheduler>(w, depth, ops);
+        std::cout << std::setw(10) << w
+                  << std::setw(18) << std::fixed << std::setprecision(0) << base
+                  << std::setw(18) << shard << "\n";
+    }
+}
+
+// The Job layout before it was made trivially copyable, kept for comparison.
+struct LegacyJob {
+    int ext_id;
+    int priority;
+    int attempt = 0;
+    int max_retries;
+    int64_t enqueue_ts;
+    std::optional<int64_t> start_ts;
+    std::optional<int64_t> end_ts;
+    int wait_ms = 0;
+    int service_ms = 0;
+    int turnaround_ms = 0;
+    std::string status = "PENDING";
+    std::string fail_reason;
+};
+
+template <class J>
+struct ByPriorityThenTs {
+    bool operator()(J const& a, J const& b) const {
+        if (a.priority != b.priority) return a.priority < b.priority;
+        return a.enqueue_ts > b.enqueue_ts;
+    }
+};
+
+// Push n jobs, then pop them all, through a std::priority_queue of J.
+template <class J>
+double heap_ops_per_s(int n) {
+    RNG rng(300, 100, 1);
+    std::vector<J> src(n);
+    for (int i = 0; i < n; ++i) {
+        src[i].ext_id = i;
+        src[i].priority = (decltype(src[i].priority))rng.priority();
+        src[i].max_retries = 2;
+        src[i].enqueue_ts = i;
+    }
+    auto t0 = Clock::now();
+    std::priority_queue<J, std::vector<J>, ByPriorityThenTs<J>> pq;
+    for (auto const& j : src) pq.push(j);
+    int64_t sink = 0;
+    while (!pq.empty()) { sink += pq.top().ext_id; pq.pop(); }
+    g_sink = sink;
+    return 2.0 * n / seconds_since(t0);
+}
+
+void bench_job_layout() {
+    const int n = 1000000;
+    std::cout << "== job layout (push+pop " << n << " jobs) ==\n"
+              << std::left << std::setw(12) << "layout"
+              << std::setw(10) << "sizeof"
+              << std::setw(14) << "heap ops/s" << "\n";
+    std::cout << std::setw(12) << "LegacyJob" << std::setw(10) << sizeof(LegacyJob)
+              << std::setw(14) << std::fixed << std::setprecision(0)
+              << heap_ops_per_s<LegacyJob>(n) << "\n";
+    std::cout << std::setw(12) << "Job" << std::setw(10) << sizeof(Job)
+              << std::setw(14) << heap_ops_per_s<Job>(n) << "\n";
+}
+
+// Journals n queued jobs through RunRecorder (group commit), then times
+// rebuilding a Scheduler from the queue table as --resume does.
+void bench_resume_recovery() {
+    const int n = 1000000;
+    ScratchDb scratch("bench_resume.db");
+    std::cout << "== resume recovery (" << n << " journaled jobs) ==\n";
+    {
+        DB db(scratch.path);
+        RunRecorder rec(db, 10000);
+        rec.journal = true;
+        RNG rng(300, 100, 1);
+        auto t0 = Clock::now();
+        rec.begin(0, 0);
+        for (int i = 1; i <= n; ++i) rec.journal_put(bench_job(i, rng));
+        rec.end(0);
+        double secs = seconds_since(t0);
+        std::cout << "journal:  " << std::fixed << std::setprecision(0)
+                  << n / secs << " puts/s\n";
+
+        auto t1 = Clock::now();
+        PooledScheduler sched;
+        int64_t loaded = rec.load_queue(rec.run_id, [&](const Job& j){ sched.push(j); });
+        double rsecs = seconds_since(t1);
+        std::cout << "recover:  " << loaded << " jobs in " << std::setprecision(1)
+                  << rsecs * 1000.0 << " ms\n";
+    }
+}
+
+// Startup for a closed batch of --jobs: Dispatcher::seed_jobs (parallel
+// generation into a pool run, one heapify per level) against admitting the
+// same jobs one at a time, and opening a database that is already at
+// DB::kSchemaVersion against one that needs the full schema check.
+void bench_startup() {
+    std::cout << "== startup ==\n"
+              << std::left << std::setw(12) << "jobs"
+              << std::setw(18) << "one-by-one ms"
+              << std::setw(18) << "bulk seed ms" << "\n";
+    for (int n : {100000, 1000000, 10000000}) {
+        Args a;
+        a.db = ":memory:";
+        a.jobs = n;
+        a.seed = 1;
+        double single_ms, bulk_ms;
+        {
+            Dispatcher d(a);
+            auto t0 = Clock::now();
+            for (int i = 1; i <= n; ++i) {
+                JobSpec spec;
+                spec.ext_id = i;
+                d.enqueue_new(d.make_job(spec, i));
+            }
+            single_ms = seconds_since(t0) * 1000.0;
+        }
+        {
+            Dispatcher d(a);
+            auto t0 = Clock::now();
+            d.seed_jobs();
+            bulk_ms = seconds_since(t0) * 1000.0;
+            g_sink += d.sched.size();
+        }
+        std::cout << std::setw(12) << n << std::fixed << std::setprecision(1)
+                  << std::setw(18) << single_ms << std::setw(18) << bulk_ms << "\n";
+    }
+
+    const int opens = 50;
+    ScratchDb scratch("bench_startup.db");
+    { DB init(scratch.path); }
+    auto t0 = Clock::now();
+    for (int i = 0; i < opens; ++i) DB db(scratch.path);
+    double warm_ms = seconds_since(t0) * 1000.0 / opens;
+    auto t1 = Clock::now();
+    for (int i = 0; i < opens; ++i) {
+        { DB reset(scratch.path); reset.exec("PRAGMA user_version=0;"); }
+        DB db(scratch.path);
+    }
+    double full_ms = seconds_since(t1) * 1000.0 / opens;
+    std::cout << "DB open:    " << std::setprecision(2) << warm_ms << " ms initialized, "
+              << full_ms << " ms with the schema check (incl. one reset open)\n";
+}
+
+// Steady-state pop+push on a single thread at several queue depths: a
+// std::priority_queue of whole Jobs under JobCmp, the same over JobRef
+// handles, and Scheduler (strict policy) over a JobPool.
+void bench_queue_depths() {
+    const int ops = 1000000;
+    std::cout << "== queue depth (pop+push, 1 thread) ==\n"
+              << std::left << std::setw(10) << "depth"
+              << std::setw(18) << "Job heap ops/s"
+              << std::setw(18) << "JobRef heap ops/s"
+              << std::setw(18) << "Scheduler ops/s" << "\n";
+    for (int depth : {1000, 100000, 1000000}) {
+        RNG rng(300, 100, 1);
+        std::priority_queue<Job, std::vector<Job>, JobCmp> pq;
+        JobHeap refs;
+        JobPool pool;
+        Scheduler sched(pool);
+        for (int i = 0; i < depth; ++i) {
+            Job j = bench_job(i, rng);
+            pq.push(j);
+            uint32_t idx = pool.acquire();
+            pool[idx] = j;
+            refs.push(JobRef{j.enqueue_ts, idx, j.priority});
+            sched.push(idx);
+        }
+        auto t0 = Clock::now();
+        for (int i = 0; i < ops; ++i) {
+            Job j = pq.top();
+            pq.pop();
+            j.enqueue_ts += depth;
+            pq.push(j);
+        }
+        double heap_rate = 2.0 * ops / seconds_since(t0);
+
+        auto t1 = Clock::now();
+        for (int i = 0; i < ops; ++i) {
+            JobRef r = refs.top();
+            refs.pop();
+            r.ts += depth;
+            refs.push(r);
+        }
+        double ref_rate = 2.0 * ops / seconds_since(t1);
+
+        auto t2 = Clock::now();
+        uint32_t idx;
+        for (int i = 0; i < ops; ++i) {
+            sched.try_pop(idx);
+            pool[idx].enqueue_ts += depth;
+            sched.push(idx);
+        }
+        double sched_rate = 2.0 * ops / seconds_since(t2);
+        std::cout << std::setw(10) << depth << std::fixed << std::setprecision(0)
+                  << std::setw(18) << heap_rate << std::setw(18) << ref_rate
+                  << std::setw(18) << sched_rate << "\n";
+    }
+}
+
+// RunRecorder rows/sec from record_job() to durable COMMIT: one row per
+// transaction (the original behaviour) against the default batch size.
+void bench_recorder() {
+    std::cout << "== recorder (record_job -> COMMIT) ==\n"
+              << std::left << std::setw(12) << "batch"
+              << std::setw(10) << "rows"
+              << std::setw(14) << "rows/s" << "\n";
+    for (int batch : {1, 100, 1000}) {
+        int rows = batch == 1 ? 20000 : 500000;
+        ScratchDb scratch("bench_recorder.db");
+        DB db(scratch.path);
+        RunRecorder rec(db, batch);
+        RNG rng(300, 100, 1);
+        Job j = bench_job(1, rng);
+        j.status = JobStatus::Success;
+        auto t0 = Clock::now();
+        rec.begin(0, 0);
+        for (int i = 0; i < rows; ++i) {
+            j.ext_id = i;
+            rec.record_job(j);
+        }
+        rec.end(0);
+        std::cout << std::setw(12) << batch << std::setw(10) << rows
+                  << std::setw(14) << std::fixed << std::setprecision(0)
+                  << rows / seconds_since(t0) << "\n";
+    }
+}
+
+// The same rows through each --sink, from record_job() to close().
+void bench_sinks() {
+    const int rows = 500000;
+    std::cout << "== sinks (" << rows << " rows) ==\n"
+              << std::left << std::setw(12) << "sink"
+              << std::setw(14) << "rows/s"
+              << std::setw(14) << "bytes/row" << "\n";
+    for (const char* kind : {"sqlite", "csv", "columnar"}) {
+        ScratchDb scratch("bench_sinks.db");
+        ScratchDb csv("bench_sinks.jobs.csv"), col("bench_sinks.jobs.col");
+        auto t0 = Clock::now();
+        {
+            DB db(scratch.path);
+            RunRecorder rec(db, 1000, make_sink(kind, db, scratch.path));
+            RNG rng(300, 100, 1);
+            Job j = bench_job(1, rng);
+            j.status = JobStatus::Success;
+            rec.begin(0, 0);
+            for (int i = 0; i < rows; ++i) {
+                j.ext_id = i;
+                j.wait_ms = i & 1023;
+                rec.record_job(j);
+            }
+            rec.end(0);
+        }
+        double secs = seconds_since(t0);
+        std::string out = std::string(kind) == "csv" ? csv.path
+                        : std::string(kind) == "columnar" ? col.path : scratch.path;
+        std::ifstream f(out, std::ios::binary | std::ios::ate);
+        int64_t bytes = (int64_t)f.tellg();
+        std::cout << std::setw(12) << kind << std::fixed << std::setprecision(0)
+                  << std::setw(14) << rows / secs << std::setprecision(1)
+                  << std::setw(14) << (double)bytes / rows << "\n";
+    }
+}
+
+// --batch: cost per job when workers pop k jobs per scheduler call and post
+// k completions per recorder call. Scheduler rows pop a batch and push each
+// job straight back; recorder rows time only the posting threads (the
+// queue is sized so they never stall behind the writer), then COMMIT.
+void bench_batching() {
+    const int threads = 8;
+    std::cout << "== batching (" << threads << " threads) ==\n"
+              << std::left << std::setw(8) << "k"
+              << std::setw(22) << "sched pop+push ns/job"
+              << std::setw(22) << "recorder post ns/job"
+              << std::setw(14) << "rows/s" << "\n";
+    for (int k : {1, 8, 32, 128}) {
+        const int depth = 10000, jobs_per_thread = 200000;
+        double sched_ns;
+        {
+            PooledScheduler q;
+            RNG rng(300, 100, 1);
+            for (int i = 0; i < depth; ++i) q.push(bench_job(i, rng));
+            std::vector<std::thread> ts;
+            auto t0 = Clock::now();
+            for (int t = 0; t < threads; ++t)
+                ts.emplace_back([&]{
+                    std::vector<uint32_t> idxs((size_t)k);
+                    for (int done = 0; done < jobs_per_thread;) {
+                        size_t n = q.sched.pop_batch(idxs.data(), (size_t)k);
+                        for (size_t i = 0; i < n; ++i) {
+                            q.pool[idxs[i]].enqueue_ts += depth;
+                            q.sched.push(idxs[i]);
+                        }
+                        done += (int)n;
+                    }
+                });
+            for (auto& t : ts) t.join();
+            sched_ns = seconds_since(t0) * 1e9 / ((double)threads * jobs_per_thread);
+        }
+
+        const int rows_per_thread = 50000;
+        ScratchDb scratch("bench_batching.db");
+        DB db(scratch.path);
+        RunRecorder rec(db, 100000);
+        rec.begin(0, 0);
+        std::vector<std::thread> ts;
+        auto t0 = Clock::now();
+        for (int t = 0; t < threads; ++t)
+            ts.emplace_back([&, t]{
+                RNG rng(300, 100, 1);
+                Job j = bench_job(t, rng);
+                j.status = JobStatus::Success;
+                RunRecorder::Outbox out;
+                out.reserve((size_t)k);
+                for (int i = 0; i < rows_per_thread; ++i) {
+                    j.ext_id = t * rows_per_thread + i;
+                    if (k == 1) {
+                        rec.record_job(j);
+                        continue;
+                    }
+                    rec.record_job(j, &out);
+                    if (out.size() >= (size_t)k) rec.complete_batch(out);
+                }
+                rec.complete_batch(out);
+            });
+        for (auto& t : ts) t.join();
+        double post_ns = seconds_since(t0) * 1e9 / rows_per_thread;  // per thread
+        rec.end(0);
+        double rows_s = (double)threads * rows_per_thread / seconds_since(t0);
+
+        std::cout << std::setw(8) << k << std::fixed << std::setprecision(1)
+                  << std::setw(22) << sched_ns << std::setw(22) << post_ns
+                  << std::setw(14) << std::setprecision(0) << rows_s << "\n";
+    }
+}
+
+// --dedup merge raising a queued job's priority: lazy decrease-key through
+// DedupIndex + Scheduler::raise against finding the job in a heap and
+// rebuilding it, and what the index adds to a pop+push (retry) loop.
+void bench_dedup() {
+    const int raises = 2000, ops = 1000000;
+    std::cout << "== dedup (1 thread) ==\n"
+              << std::left << std::setw(10) << "depth"
+              << std::setw(18) << "lazy raise ns"
+              << std::setw(18) << "rebuild ns"
+              << std::setw(18) << "pop+push ns"
+              << std::setw(18) << "indexed ns" << "\n";
+    for (int depth : {1000, 100000}) {
+        RNG rng(300, 100, 1);
+        std::vector<Job> jobs;
+        for (int i = 0; i < depth; ++i) {
+            Job j = bench_job(i, rng);
+            j.priority = 1;
+            jobs.push_back(j);
+        }
+        auto dup_of = [&](int i) {
+            Job dup = jobs[(size_t)(i * 7919) % jobs.size()];
+            dup.priority = (int16_t)(2 + i % 9);
+            return dup;
+        };
+
+        double loop_ns[2];
+        double lazy_ns = 0;
+        for (int indexed = 0; indexed < 2; ++indexed) {
+            JobPool pool;
+            DedupIndex index;
+            index.mode = DedupIndex::Mode::Merge;
+            Scheduler sched(pool);
+            if (indexed) sched.dedup = &index;
+            auto raise = [&](uint32_t slot, int16_t p){ return sched.raise(slot, p); };
+            for (const Job& j : jobs) {
+                uint32_t idx = pool.acquire();
+                pool[idx] = j;
+                if (indexed) index.admit(j, idx, raise);
+                sched.push(idx);
+            }
+            if (indexed) {
+                auto t0 = Clock::now();
+                for (int i = 0; i < raises; ++i) index.admit(dup_of(i), DedupIndex::kNoSlot, raise);
+                lazy_ns = seconds_since(t0) * 1e9 / raises;
+            }
+            // A popped job goes back in the way a retry does.
+            auto t1 = Clock::now();
+            uint32_t idx;
+            for (int i = 0; i < ops; ++i) {
+                if (!sched.try_pop(idx)) break;
+                Job& j = pool[idx];
+                j.enqueue_ts += depth;
+                if (indexed) index.requeue(j, [&]{ sched.push(idx); });
+                else sched.push(idx);
+            }
+            loop_ns[indexed] = seconds_since(t1) * 1e9 / ops;
+        }
+
+        std::vector<JobRef> heap;
+        for (size_t i = 0; i < jobs.size(); ++i)
+            heap.push_back(JobRef{jobs[i].enqueue_ts, (uint32_t)i, jobs[i].priority});
+        std::make_heap(heap.begin(), heap.end(), JobCmp());
+        auto t2 = Clock::now();
+        for (int i = 0; i < raises; ++i) {
+            Job dup = dup_of(i);
+            for (JobRef& r : heap)
+                if (r.idx == (uint32_t)(dup.ext_id) && dup.priority > r.priority) {
+                    r.priority = dup.priority;
+                    std::make_heap(heap.begin(), heap.end(), JobCmp());
+                    break;
+                }
+        }
+        double rebuild_ns = seconds_since(t2) * 1e9 / raises;
+        g_sink += heap.front().idx;
+
+        std::cout << std::setw(10) << depth << std::fixed << std::setprecision(0)
+                  << std::setw(18) << lazy_ns << std::setw(18) << rebuild_ns
+                  << std::setw(18) << loop_ns[0] << std::setw(18) << loop_ns[1] << "\n";
+    }
+}
+
+// Per-worker counters three ways: one set of shared atomics, plain structs
+// packed next to each other (false sharing), and cache-line aligned
+// WorkerStats-style structs. Then pop+push scaling on a shared Scheduler,
+// threads unpinned or pinned compact / spread over the detected NUMA nodes.
+struct PackedCounters {
+    int64_t successes = 0, total_wait = 0;
+};
+struct alignas(64) PaddedCounters {
+    int64_t successes = 0, total_wait = 0;
+};
+
+template <class Body>
+double threads_ops_per_s(int threads, int ops_per_thread, const std::vector<int>& cpus, Body body) {
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> ts;
+    for (int t = 0; t < threads; ++t)
+        ts.emplace_back([&, t]{
+            if (!cpus.empty()) pin_this_thread(cpus[(size_t)t]);
+            ready.fetch_add(1);
+            while (!go.load()) std::this_thread::yield();
+            body(t, ops_per_thread);
+        });
+    while (ready.load() < threads) std::this_thread::yield();
+    auto t0 = Clock::now();
+    go.store(true);
+    for (auto& th : ts) th.join();
+    return (double)threads * ops_per_thread / seconds_since(t0);
+}
+
+void bench_pinning() {
+    CpuTopology topo = CpuTopology::detect();
+    std::vector<int> counts;
+    for (int t = 1; t < topo.cpus(); t *= 2) counts.push_back(t);
+    counts.push_back(std::max(1, topo.cpus()));
+    const int counter_ops = 5000000, sched_ops = 200000;
+
+    std::cout << "== worker stats layout (" << topo.cpus() << " CPUs, "
+              << topo.nodes.size() << " NUMA nodes) ==\n"
+              << std::left << std::setw(10) << "threads"
+              << std::setw(18) << "shared atomic/s"
+              << std::setw(18) << "packed/s"
+              << std::setw(18) << "padded/s" << "\n";
+    for (int t : counts) {
+        std::atomic<int64_t> shared_succ{0}, shared_wait{0};
+        double shared = threads_ops_per_s(t, counter_ops, {}, [&](int, int n){
+            for (int i = 0; i < n; ++i) {
+                shared_succ.fetch_add(1, std::memory_order_relaxed);
+                shared_wait.fetch_add(i & 7, std::memory_order_relaxed);
+            }
+        });
+        // volatile keeps each increment a store, as a worker's would be.
+        std::vector<PackedCounters> packed((size_t)t);
+        double packed_rate = threads_ops_per_s(t, counter_ops, {}, [&](int w, int n){
+            volatile int64_t* c = &packed[(size_t)w].successes;
+            for (int i = 0; i < n; ++i) { c[0] = c[0] + 1; c[1] = c[1] + (i & 7); }
+        });
+        std::vector<PaddedCounters> padded((size_t)t);
+        double padded_rate = threads_ops_per_s(t, counter_ops, {}, [&](int w, int n){
+            volatile int64_t* c = &padded[(size_t)w].successes;
+            for (int i = 0; i < n; ++i) { c[0] = c[0] + 1; c[1] = c[1] + (i & 7); }
+        });
+        std::cout << std::setw(10) << t << std::fixed << std::setprecision(0)
+                  << std::setw(18) << shared << std::setw(18) << packed_rate
+                  << std::setw(18) << padded_rate << "\n";
+    }
+
+    std::cout << "== scheduler scaling by --pin-workers (pop+push/s) ==\n"
+              << std::left << std::setw(10) << "threads"
+              << std::setw(18) << "off" << std::setw(18) << "compact"
+              << std::setw(18) << "spread" << "\n";
+    for (int t : counts) {
+        std::cout << std::setw(10) << t << std::fixed << std::setprecision(0);
+        for (const char* mode : {"off", "compact", "spread"}) {
+            PooledScheduler q;
+            RNG rng(300, 100, 1);
+            for (int i = 0; i < 10000; ++i) q.push(bench_job(i, rng));
+            std::vector<int> cpus;
+            if (std::string(mode) != "off") cpus = topo.plan(t, mode);
+            std::vector<WorkerStats> stats((size_t)t);
+            double rate = threads_ops_per_s(t, sched_ops, cpus, [&](int w, int n){
+                WorkerStats& st = stats[(size_t)w];
+                uint32_t idx;
+                for (int i = 0; i < n; ++i) {
+                    if (!q.sched.try_pop(idx)) continue;
+                    Job& j = q.pool[idx];
+                    st.successes++;
+                    st.wait_h.record(j.ext_id & 255);
+                    j.enqueue_ts += 10000;
+                    q.sched.push(idx);
+                }
+            });
+            std::cout << std::setw(18) << rate;
+        }
+        std::cout << "\n";
+    }
+}
+
+void bench_rng() {
+    const int n = 10000000;
+    RNG rng(300, 100, 1);
+    std::cout << "== rng (" << n << " calls) ==\n" << std::fixed << std::setprecision(2);
+
+    int64_t sink = 0;
+    auto t0 = Clock::now();
+    for (int i = 0; i < n; ++i) sink += rng.service_ms();
+    std::cout << "service_ms:   " << seconds_since(t0) * 1e9 / n << " ns/call\n";
+
+    auto t1 = Clock::now();
+    for (int i = 0; i < n; ++i) sink += rng.should_fail(i & 3);
+    std::cout << "should_fail:  " << seconds_since(t1) * 1e9 / n << " ns/call\n";
+
+    auto t2 = Clock::now();
+    for (int i = 0; i < n; ++i) sink += rng.priority();
+    std::cout << "priority:     " << seconds_since(t2) * 1e9 / n << " ns/call\n";
+
+    // What a worker pays per attempt: reseed onto the job's stream, then draw.
+    auto t3 = Clock::now();
+    for (int i = 0; i < n; ++i) {
+        rng.begin(i, 0);
+        sink += rng.service_ms() + rng.should_fail(0);
+    }
+    std::cout << "per attempt:  " << seconds_since(t3) * 1e9 / n << " ns/attempt\n";
+    g_sink = sink;
+}
+
+// Whole dispatcher in --virtual-clock mode: scheduling, attempt logic,
+// histograms and SQLite rows, without any sleeping.
+void bench_end_to_end() {
+    std::cout << "== end-to-end (--virtual-clock, quiet) ==\n"
+              << std::left << std::setw(10) << "jobs"
+              << std::setw(10) << "workers"
+              << std::setw(14) << "jobs/s" << "\n";
+    for (int workers : {1, 8, 64}) {
+        ScratchDb scratch("bench_e2e.db");
+        Args a;
+        a.jobs = 200000;
+        a.workers = workers;
+        a.virtual_clock = true;
+        a.log_level = "quiet";
+        a.db = scratch.path;
+        auto t0 = Clock::now();
+        {
+            Dispatcher d(a);
+            d.run();
+        }
+        std::cout << std::setw(10) << a.jobs << std::setw(10) << workers
+                  << std::setw(14) << std::fixed << std::setprecision(0)
+                  << a.jobs / seconds_since(t0) << "\n";
+    }
+}
+
+// Heap allocations per job once warmed up. The pool/scheduler loop admits,
+// schedules and retires jobs through a bounded live set; the end-to-end row
+// runs an open-loop --virtual-clock Dispatcher at two lengths and divides
+// the difference, so one-time setup and pool growth cancel out.
+void bench_allocations() {
+    std::cout << "== allocations (counting operator new) ==\n"
+              << std::left << std::setw(28) << "path"
+              << std::setw(14) << "allocs/job" << "\n";
+    {
+        const int live = 4096, n = 1000000;
+        RNG rng(300, 100, 1);
+        JobPool pool;
+        Scheduler sched(pool);
+        auto admit = [&](int id){
+            uint32_t idx = pool.acquire();
+            pool[idx] = bench_job(id, rng);
+            sched.push(idx);
+        };
+        for (int i = 0; i < live; ++i) admit(i);
+        for (int i = 0; i < live; ++i) { // warm every heap to its peak size
+            uint32_t idx;
+            sched.try_pop(idx);
+            pool.release(idx);
+            admit(live + i);
+        }
+        uint64_t before = g_allocs.load();
+        for (int i = 0; i < n; ++i) {
+            uint32_t idx;
+            sched.try_pop(idx);
+            pool.release(idx);
+            admit(2 * live + i);
+        }
+        std::cout << std::setw(28) << "pool + scheduler" << std::fixed << std::setprecision(4)
+                  << (double)(g_allocs.load() - before) / n << "\n";
+    }
+
+    auto run_allocs = [](int jobs){
+        ScratchDb scratch("bench_alloc.db");
+        Args a;
+        a.jobs = jobs;
+        a.workers = 8;
+        a.arrival_rate = 20;     // ~75% utilization at the default service times
+        a.virtual_clock = true;
+        a.log_level = "quiet";
+        a.seed = 1;
+        a.db = scratch.path;
+        Dispatcher d(a);
+        uint64_t before = g_allocs.load();
+        d.run();
+        return g_allocs.load() - before;
+    };
+    const int n = 100000;
+    uint64_t small = run_allocs(n), large = run_allocs(2 * n);
+    std::cout << std::setw(28) << "end-to-end (virtual clock)"
+              << (double)((int64_t)large - (int64_t)small) / n
+              << "   (" << small << " for " << n << " jobs)\n";
+}
+
+// --------------------------- main ---------------------------
+struct BenchCase {
+    const char* name;
+    void (*fn)();
+};
+
+const BenchCase kCases[] = {
+    {"scheduler_contention", bench_scheduler_contention},
+    {"queue_depth", bench_queue_depths},
+    {"job_layout", bench_job_layout},
+    {"recorder", bench_recorder},
+    {"batching", bench_batching},
+    {"sinks", bench_sinks},
+    {"dedup", bench_dedup},
+    {"pinning", bench_pinning},
+    {"rng", bench_rng},
+    {"end_to_end", bench_end_to_end},
+    {"allocations", bench_allocations},
+    {"resume_recovery", bench_resume_recovery},
+    {"startup", bench_startup},
+};
+
+int main(int argc, char** argv) {
+    std::string filter = argc > 1 ? argv[1] : "";
+    if (filter == "--list") {
+        for (const auto& c : kCases) std::cout << c.name << "\n";
+        return 0;
+    }
+    for (const auto& c : kCases) {
+        if (!filter.empty() && std::string(c.name).find(filter) == std::string::npos) continue;
+        c.fn();
+        std::cout << "\n";
+    }
+    return 0;
+}